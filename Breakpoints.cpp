@@ -0,0 +1,80 @@
+#include "Breakpoints.h"
+#include "pluginmain.h"
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+// Open addressing with linear probing; address 0 marks an empty slot and is
+// tracked separately
+struct AddressSet {
+  std::vector<duint> slots;
+  size_t mask = 0;
+  bool hasZero = false;
+
+  static size_t Hash(duint addr) {
+    uint64_t h = (uint64_t)addr * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h ^ (h >> 32));
+  }
+
+  void assign(const std::vector<duint> &addrs) {
+    size_t capacity = 16;
+    while (capacity < addrs.size() * 2) // Load factor <= 1/2
+      capacity <<= 1;
+    slots.assign(capacity, 0);
+    mask = capacity - 1;
+    hasZero = false;
+    for (duint addr : addrs) {
+      if (!addr) {
+        hasZero = true;
+        continue;
+      }
+      size_t k = Hash(addr) & mask;
+      while (slots[k] && slots[k] != addr)
+        k = (k + 1) & mask;
+      slots[k] = addr;
+    }
+  }
+
+  bool contains(duint addr) const {
+    if (!addr)
+      return hasZero;
+    if (slots.empty())
+      return false;
+    for (size_t k = Hash(addr) & mask; slots[k]; k = (k + 1) & mask) {
+      if (slots[k] == addr)
+        return true;
+    }
+    return false;
+  }
+};
+
+static std::atomic<unsigned int> g_BpEpoch{1};
+static unsigned int g_BpLoadedEpoch = 0;
+static AddressSet g_BpSet;
+
+void InvalidateBreakpoints() { ++g_BpEpoch; }
+
+static void LoadBreakpoints() {
+  std::vector<duint> addrs;
+  BPMAP list = {};
+  DbgGetBpList(bp_none, &list); // All types
+  for (int i = 0; i < list.count; ++i) {
+    // DLL and exception breakpoints have no code address; disabled ones
+    // are not reported by DbgGetBpxTypeAt either
+    if (list.bp[i].enabled &&
+        (list.bp[i].type & (bp_normal | bp_hardware | bp_memory)))
+      addrs.push_back(list.bp[i].addr);
+  }
+  if (list.bp)
+    BridgeFree(list.bp);
+  g_BpSet.assign(addrs);
+}
+
+bool HasBreakpoint(duint addr) {
+  unsigned int epoch = g_BpEpoch;
+  if (epoch != g_BpLoadedEpoch) {
+    LoadBreakpoints();
+    g_BpLoadedEpoch = epoch;
+  }
+  return g_BpSet.contains(addr);
+}
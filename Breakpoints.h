@@ -0,0 +1,14 @@
+#pragma once
+#include "pluginsdk/_plugin_types.h"
+
+// Snapshot of the debuggee's breakpoint addresses for the list painting.
+// Loaded with one DbgGetBpList into a flat hash set the first time it is
+// asked after an invalidation, so painting a row is a probe instead of a
+// DbgGetBpxTypeAt call into the debugger. Covers the types
+// DbgGetBpxTypeAt reports: software, hardware and memory breakpoints.
+
+// Breakpoints may have changed (debug events, toggles). Any thread.
+void InvalidateBreakpoints();
+
+// A breakpoint is set at 'addr'. UI thread.
+bool HasBreakpoint(duint addr);
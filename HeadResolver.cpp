@@ -0,0 +1,197 @@
+#include "HeadResolver.h"
+#include "MemCache.h"
+#include "pluginmain.h"
+#include <algorithm>
+#include <vector>
+
+// Self-synchronising windows (bytes before the patch)
+#define WINDOW_NEAR 32
+#define WINDOW_FAR 64
+
+// Finalized Solution: Official SDK Demands (OSD)
+duint FindCorrectOldHead(duint patchAddr) {
+  const DBGFUNCTIONS *funcs = DbgFunctions();
+  if (!funcs)
+    return patchAddr;
+
+  // Strategy 1: Source Info
+  char sourceFile[MAX_PATH] = {0};
+  int line = 0;
+  if (funcs->GetSourceFromAddr &&
+      funcs->GetSourceFromAddr(patchAddr, sourceFile, &line)) {
+    duint displacement = 0;
+    duint addr = funcs->GetAddrFromLine(sourceFile, line, &displacement);
+    if (addr != 0 && addr <= patchAddr) {
+      return addr;
+    }
+  }
+
+  // Strategy 2: DbgEval Expression
+  char expr[128];
+  bool success = false;
+  _set_errno(0);
+#ifdef _WIN64
+  sprintf(expr, "dis.prev(0x%llX + 1)", (unsigned long long)patchAddr);
+#else
+  sprintf(expr, "dis.prev(0x%X + 1)", (unsigned int)patchAddr);
+#endif
+
+  duint head = DbgEval(expr, &success);
+  if (success && head != 0 && head <= patchAddr) {
+#ifdef _WIN64
+    sprintf(expr, "dis.len(0x%llX)", (unsigned long long)head);
+#else
+    sprintf(expr, "dis.len(0x%X)", (unsigned int)head);
+#endif
+    duint len = DbgEval(expr, &success);
+    if (success && patchAddr < head + len) {
+      return head;
+    }
+  }
+
+  // Strategy 3: Trace Record
+  for (int off = 0; off <= 15; ++off) {
+    if (patchAddr < (duint)off)
+      break;
+    duint test = patchAddr - off;
+    if (funcs->GetTraceRecordByteType &&
+        funcs->GetTraceRecordByteType(test) == 1) {
+      return test;
+    }
+  }
+
+  return patchAddr;
+}
+
+HeadResolver::HeadResolver(const PatchStore &previous) {
+  m_knownHeads.reserve(previous.size());
+  for (size_t i = 0; i < previous.size(); ++i)
+    m_knownHeads.push_back(previous.Head(i));
+  std::sort(m_knownHeads.begin(), m_knownHeads.end());
+}
+
+// Decode forward from 'anchor' until the instruction covering
+// groups[index].address. Fails if the bytes before the patch are unreadable
+// or don't decode.
+bool HeadResolver::DecodeTo(const std::vector<PatchInfo> &groups, size_t index,
+                            duint anchor, duint &head) {
+  const DBGFUNCTIONS *funcs = DbgFunctions();
+  duint addr = groups[index].address;
+  if (!funcs || !funcs->DisasmFast || anchor > addr)
+    return false;
+
+  duint span = addr - anchor;
+  std::vector<unsigned char> buf((size_t)span + MAX_INSTRUCTION_LENGTH + 1);
+  if (!CachedMemRead(anchor, buf.data(), span + 1))
+    return false;
+  CachedMemRead(anchor + span + 1, buf.data() + span + 1,
+                MAX_INSTRUCTION_LENGTH); // Tail may run off the region
+
+  // Put the original bytes back for every group inside the buffer
+  duint bufEnd = anchor + buf.size();
+  for (size_t k = index + 1; k-- > 0;) {
+    const PatchInfo &g = groups[k];
+    if (g.address + g.oldBytes.size() <= anchor)
+      break;
+    for (size_t b = 0; b < g.oldBytes.size(); ++b) {
+      duint a = g.address + b;
+      if (a >= anchor && a < bufEnd)
+        buf[(size_t)(a - anchor)] = g.oldBytes[b];
+    }
+  }
+  for (size_t k = index + 1; k < groups.size() && groups[k].address < bufEnd;
+       ++k) {
+    const PatchInfo &g = groups[k];
+    for (size_t b = 0; b < g.oldBytes.size() && g.address + b < bufEnd; ++b)
+      buf[(size_t)(g.address + b - anchor)] = g.oldBytes[b];
+  }
+
+  BASIC_INSTRUCTION_INFO info;
+  duint cur = anchor;
+  while (true) {
+    if (!funcs->DisasmFast(buf.data() + (size_t)(cur - anchor), cur, &info) ||
+        info.size <= 0)
+      return false;
+    if (addr < cur + info.size) {
+      head = cur;
+      return true;
+    }
+    cur += info.size;
+  }
+}
+
+bool HeadResolver::FindKnownHead(duint addr, duint &anchor) const {
+  bool found = false;
+  if (m_lastHead != 0 && m_lastHead <= addr) {
+    anchor = m_lastHead;
+    found = true;
+  }
+  auto it = std::upper_bound(m_knownHeads.begin(), m_knownHeads.end(), addr);
+  if (it != m_knownHeads.begin()) {
+    duint prevHead = *(it - 1);
+    if (!found || prevHead > anchor) {
+      anchor = prevHead;
+      found = true;
+    }
+  }
+  return found && addr - anchor <= MAX_KNOWN_HEAD_DISTANCE;
+}
+
+bool HeadResolver::FindFunctionStart(duint addr, duint &anchor) {
+  // Sorted groups tend to fall into the same function; reuse the last range
+  if (!(m_funcStart <= addr && addr <= m_funcEnd && m_funcEnd != 0)) {
+    duint start = 0, end = 0;
+    if (!DbgFunctionGet(addr, &start, &end))
+      return false;
+    m_funcStart = start;
+    m_funcEnd = end;
+  }
+  anchor = m_funcStart;
+  return m_funcStart <= addr && addr - m_funcStart <= MAX_FUNCTION_DISTANCE;
+}
+
+duint HeadResolver::Resolve(const std::vector<PatchInfo> &groups,
+                            size_t index) {
+  const PatchInfo &p = groups[index];
+  duint addr = p.address;
+  duint candidates[4];
+  int count = 0;
+  duint anchor, head;
+
+  if (FindKnownHead(addr, anchor) && DecodeTo(groups, index, anchor, head))
+    candidates[count++] = head;
+  if (FindFunctionStart(addr, anchor) && DecodeTo(groups, index, anchor, head))
+    candidates[count++] = head;
+
+  // Windows only count when both decode; one alone is not trusted
+  duint nearHead, farHead;
+  if (addr >= WINDOW_FAR &&
+      DecodeTo(groups, index, addr - WINDOW_NEAR, nearHead) &&
+      DecodeTo(groups, index, addr - WINDOW_FAR, farHead)) {
+    candidates[count++] = nearHead;
+    candidates[count++] = farHead;
+  }
+
+  if (count > 0 &&
+      std::all_of(candidates + 1, candidates + count,
+                  [&](duint c) { return c == candidates[0]; })) {
+    m_lastHead = candidates[0];
+    m_stats.local++;
+    return candidates[0];
+  }
+
+  // Anchors disagree: a candidate that was executed as a heading wins
+  const DBGFUNCTIONS *funcs = DbgFunctions();
+  if (funcs && funcs->GetTraceRecordByteType) {
+    for (int i = 0; i < count; ++i) {
+      if (funcs->GetTraceRecordByteType(candidates[i]) == InstructionHeading) {
+        m_lastHead = candidates[i];
+        m_stats.traced++;
+        return candidates[i];
+      }
+    }
+  }
+
+  m_stats.debugger++;
+  return FindCorrectOldHead(addr);
+}
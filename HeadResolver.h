@@ -0,0 +1,53 @@
+#pragma once
+#include "PatchWindow.h"
+
+// Longest x86 instruction
+#define MAX_INSTRUCTION_LENGTH 15
+
+// How far back an anchor may be before decoding from it is not worth it.
+// Resolve never reads groups that end further back than the larger one.
+#define MAX_KNOWN_HEAD_DISTANCE 0x100
+#define MAX_FUNCTION_DISTANCE 0x1000
+
+// Finds the instruction head that covers a patched address in the ORIGINAL
+// code without going through DbgEval. Instruction lengths are decoded with
+// DisasmFast over cached memory (old bytes of all nearby groups put back),
+// starting from known boundaries:
+//   - heads resolved earlier (this sync or the previous one)
+//   - the start of the enclosing analysed function (DbgFunctionGet)
+//   - two windows before the address (x86 decoding re-synchronises quickly)
+// When every anchor lands on the same head it is accepted. Only when they
+// disagree are the trace record and finally the debugger asked.
+// Not thread-safe; one resolver per sync.
+class HeadResolver {
+public:
+  // 'previous' supplies heads from the last sync as anchors
+  explicit HeadResolver(const PatchStore &previous);
+
+  // Resolve groups[index]. 'groups' must be sorted by address and its
+  // oldBytes intact (they are put back into the decode buffer).
+  duint Resolve(const std::vector<PatchInfo> &groups, size_t index);
+
+  struct Stats {
+    size_t local;    // All anchors agreed
+    size_t traced;   // Disagreement settled by the trace record
+    size_t debugger; // Disagreement settled by FindCorrectOldHead
+  };
+  const Stats &GetStats() const { return m_stats; }
+
+private:
+  bool DecodeTo(const std::vector<PatchInfo> &groups, size_t index,
+                duint anchor, duint &head);
+  bool FindKnownHead(duint addr, duint &anchor) const;
+  bool FindFunctionStart(duint addr, duint &anchor);
+
+  std::vector<duint> m_knownHeads; // Sorted
+  duint m_lastHead = 0;            // Last head resolved locally this sync
+  duint m_funcStart = 0;           // Cached DbgFunctionGet range
+  duint m_funcEnd = 0;
+  Stats m_stats = {0, 0, 0};
+};
+
+// Original strategy chain through the debugger: source line, dis.prev and
+// the trace record. Used when the local anchors disagree.
+duint FindCorrectOldHead(duint patchAddr);
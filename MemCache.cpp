@@ -0,0 +1,78 @@
+#include "MemCache.h"
+#include "pluginmain.h"
+#include <atomic>
+#include <mutex>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+// Upper bound on cached pages (16 MB); the cache is flushed when reached
+#define MEMCACHE_MAX_PAGES 4096
+
+struct CachedPage {
+  unsigned int epoch;
+  bool readable;
+  std::vector<unsigned char> data;
+};
+
+static std::atomic<unsigned int> g_MemEpoch{1};
+static std::mutex g_MemLock;
+static std::unordered_map<duint, CachedPage> g_MemPages;
+
+// Returns the page at 'base' for the current epoch, reading it if needed.
+// Caller holds g_MemLock.
+static const CachedPage &GetPage(duint base, unsigned int epoch) {
+  auto it = g_MemPages.find(base);
+  if (it != g_MemPages.end() && it->second.epoch == epoch)
+    return it->second;
+
+  if (it == g_MemPages.end()) {
+    if (g_MemPages.size() >= MEMCACHE_MAX_PAGES)
+      g_MemPages.clear();
+    it = g_MemPages.emplace(base, CachedPage()).first;
+  }
+
+  CachedPage &page = it->second;
+  page.epoch = epoch;
+  page.data.resize(PAGE_SIZE);
+  page.readable = DbgMemRead(base, page.data.data(), PAGE_SIZE);
+  if (!page.readable)
+    memset(page.data.data(), 0, PAGE_SIZE);
+  return page;
+}
+
+bool CachedMemRead(duint addr, void *dest, duint size) {
+  if (size == 0)
+    return true;
+
+  // Memory changes under us while the debuggee runs; don't cache then
+  if (DbgIsRunning())
+    return DbgMemRead(addr, dest, size);
+
+  unsigned char *out = (unsigned char *)dest;
+  unsigned int epoch = g_MemEpoch;
+  bool ok = true;
+
+  std::lock_guard<std::mutex> guard(g_MemLock);
+  while (size > 0) {
+    duint base = addr & ~(duint)(PAGE_SIZE - 1);
+    duint offset = addr - base;
+    duint chunk = PAGE_SIZE - offset;
+    if (chunk > size)
+      chunk = size;
+
+    const CachedPage &page = GetPage(base, epoch);
+    memcpy(out, page.data.data() + offset, chunk);
+    if (!page.readable)
+      ok = false;
+
+    out += chunk;
+    addr += chunk;
+    size -= chunk;
+  }
+  return ok;
+}
+
+void InvalidateMemCache() { ++g_MemEpoch; }
+
+unsigned int MemCacheEpoch() { return g_MemEpoch; }
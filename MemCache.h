@@ -0,0 +1,17 @@
+#pragma once
+#include "pluginsdk/_plugin_types.h"
+
+// Page-granular cache of debuggee memory shared by the sync worker and the
+// list painting. Pages are read once per epoch with one DbgMemRead each; the
+// epoch is bumped whenever debuggee memory may have changed (pause, step,
+// module load/unload, patches applied by this plugin).
+
+// Read [addr, addr + size). Unreadable pages are zero-filled and make the
+// call return false, like a failed DbgMemRead.
+bool CachedMemRead(duint addr, void *dest, duint size);
+
+// Drop all cached pages
+void InvalidateMemCache();
+
+// Current epoch; changes on every invalidation
+unsigned int MemCacheEpoch();
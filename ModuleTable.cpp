@@ -0,0 +1,66 @@
+#include "ModuleTable.h"
+#include <ctype.h>
+#include <deque>
+#include <mutex>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+
+static std::mutex g_ModuleLock; // Guards everything below
+static std::deque<std::string> g_ModuleNames(1); // Indexed by ID, [0] is ""
+static std::unordered_map<std::string, ModuleId> g_ModuleIds;
+
+ModuleId InternModule(const char *name) {
+  if (!name || !name[0])
+    return MODULE_NONE;
+  std::lock_guard<std::mutex> guard(g_ModuleLock);
+  auto it = g_ModuleIds.find(name);
+  if (it != g_ModuleIds.end())
+    return it->second;
+  if (g_ModuleNames.size() > MODULE_MAX_IDS)
+    return MODULE_NONE;
+  ModuleId id = (ModuleId)g_ModuleNames.size();
+  g_ModuleNames.emplace_back(name);
+  g_ModuleIds.emplace(g_ModuleNames.back(), id);
+  return id;
+}
+
+const char *ModuleNameById(ModuleId id) {
+  std::lock_guard<std::mutex> guard(g_ModuleLock);
+  if (id >= g_ModuleNames.size())
+    return "";
+  // deque::emplace_back never moves existing elements
+  return g_ModuleNames[id].c_str();
+}
+
+ModuleId FindModule(const char *name) {
+  if (!name || !name[0])
+    return MODULE_NONE;
+  std::lock_guard<std::mutex> guard(g_ModuleLock);
+  auto it = g_ModuleIds.find(name);
+  return it != g_ModuleIds.end() ? it->second : MODULE_NONE;
+}
+
+static bool EqualNoCase(const char *a, const char *b, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+      return false;
+  }
+  return true;
+}
+
+void FindModulesNoCase(const char *name, std::vector<ModuleId> &ids) {
+  ids.clear();
+  if (!name || !name[0])
+    return;
+  size_t len = strlen(name);
+  std::lock_guard<std::mutex> guard(g_ModuleLock);
+  for (size_t id = 1; id < g_ModuleNames.size(); ++id) {
+    const std::string &module = g_ModuleNames[id];
+    if (module.size() < len || !EqualNoCase(module.c_str(), name, len))
+      continue;
+    if (module.size() == len ||
+        (module[len] == '.' && module.find('.', len + 1) == std::string::npos))
+      ids.push_back((ModuleId)id);
+  }
+}
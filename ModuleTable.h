@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+// Interned module names. Every distinct module name seen in PatchEnum gets a
+// small integer ID for the lifetime of the plugin, so grouping and module
+// scoped operations compare integers instead of strings. ID 0 is the empty
+// name. Thread-safe; names are never removed, so pointers stay valid.
+typedef uint16_t ModuleId;
+
+#define MODULE_NONE 0
+#define MODULE_MAX_IDS 0xFFFF
+
+// ID for 'name', adding it if needed. Returns MODULE_NONE for an empty name
+// or when the table is full.
+ModuleId InternModule(const char *name);
+
+// Name for 'id' ("" for unknown IDs)
+const char *ModuleNameById(ModuleId id);
+
+// ID for 'name' without adding it; MODULE_NONE if it was never interned
+ModuleId FindModule(const char *name);
+
+// IDs of every module named 'name', ignoring case. A name without an
+// extension also matches "name.dll", "name.exe" and so on.
+void FindModulesNoCase(const char *name, std::vector<ModuleId> &ids);
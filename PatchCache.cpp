@@ -0,0 +1,191 @@
+#include "PatchCache.h"
+#include "PatchWindow.h"
+#include "pluginmain.h"
+#include "pluginsdk/lz4/lz4.h"
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+#define PATCHCACHE_FILE_NAME "PatchKing.cache"
+#define PATCHCACHE_MAGIC 0x33434B50 // "PKC3"
+// Above this many entries, a save keeps only the ones used this session
+#define PATCHCACHE_MAX_ENTRIES 200000
+#define PATCHCACHE_MAX_RAW_SIZE (256 * 1024 * 1024)
+
+struct CacheRecord {
+  PatchCacheEntry entry;
+  bool used; // Looked up or stored this session
+};
+
+static std::mutex g_CacheLock; // Guards everything below
+static std::unordered_map<std::string, CacheRecord> g_Cache;
+static bool g_CacheLoaded = false;
+static bool g_CacheDirty = false;
+
+struct CacheFileHeader {
+  uint32_t magic;
+  uint32_t rawSize;
+  uint32_t packedSize;
+};
+
+static std::string MakeKey(const PatchCacheKey &key) {
+  std::string k = key.module;
+  k.push_back('\0');
+  k.append((const char *)&key.rva, sizeof(key.rva));
+  k.append((const char *)&key.hash, sizeof(key.hash));
+  return k;
+}
+
+static std::string CachePath() {
+  char path[MAX_PATH] = "";
+  if (!GetModuleFileNameA(hInst, path, MAX_PATH))
+    return PATCHCACHE_FILE_NAME;
+  char *slash = strrchr(path, '\\');
+  if (slash)
+    slash[1] = 0;
+  else
+    path[0] = 0;
+  return std::string(path) + PATCHCACHE_FILE_NAME;
+}
+
+// --- Serialization ---
+
+static void PutU16(std::vector<char> &out, uint16_t v) {
+  out.insert(out.end(), (const char *)&v, (const char *)&v + sizeof(v));
+}
+
+static void PutString(std::vector<char> &out, const std::string &s) {
+  uint16_t len = s.size() > 0xFFFF ? 0xFFFF : (uint16_t)s.size();
+  PutU16(out, len);
+  out.insert(out.end(), s.data(), s.data() + len);
+}
+
+// Bounds-checked reader over the decompressed payload
+struct CacheReader {
+  const char *pos;
+  const char *end;
+
+  bool Read(void *dst, size_t size) {
+    if ((size_t)(end - pos) < size)
+      return false;
+    memcpy(dst, pos, size);
+    pos += size;
+    return true;
+  }
+
+  bool ReadString(std::string &s) {
+    uint16_t len;
+    if (!Read(&len, sizeof(len)) || (size_t)(end - pos) < len)
+      return false;
+    s.assign(pos, len);
+    pos += len;
+    return true;
+  }
+};
+
+// Caller holds g_CacheLock
+static void LoadCacheFile() {
+  g_CacheLoaded = true;
+  FILE *fp = fopen(CachePath().c_str(), "rb");
+  if (!fp)
+    return;
+
+  CacheFileHeader header;
+  std::vector<char> packed, raw;
+  bool ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+            header.magic == PATCHCACHE_MAGIC &&
+            header.rawSize <= PATCHCACHE_MAX_RAW_SIZE &&
+            header.packedSize <= (uint32_t)LZ4_compressBound(header.rawSize);
+  if (ok) {
+    packed.resize(header.packedSize);
+    raw.resize(header.rawSize);
+    ok = fread(packed.data(), 1, packed.size(), fp) == packed.size() &&
+         (raw.empty() ||
+          LZ4_decompress_safe(packed.data(), raw.data(), (int)packed.size(),
+                              (int)raw.size()) == (int)raw.size());
+  }
+  fclose(fp);
+  if (!ok) {
+    Log("[PatchMgr] Ignoring unreadable %s\n", PATCHCACHE_FILE_NAME);
+    return;
+  }
+
+  CacheReader reader = {raw.data(), raw.data() + raw.size()};
+  while (reader.pos < reader.end) {
+    std::string key;
+    CacheRecord record;
+    record.used = false;
+    if (!reader.ReadString(key) ||
+        !reader.Read(&record.entry.headDelta, sizeof(int32_t)) ||
+        !reader.ReadString(record.entry.oldDisasm) ||
+        !reader.ReadString(record.entry.disasm) ||
+        !reader.ReadString(record.entry.comment))
+      break; // Truncated; keep what was read
+    g_Cache[key] = std::move(record);
+  }
+  Log("[PatchMgr] Loaded %d cached groups\n", (int)g_Cache.size());
+}
+
+bool PatchCacheLookup(const PatchCacheKey &key, PatchCacheEntry &entry) {
+  std::lock_guard<std::mutex> guard(g_CacheLock);
+  if (!g_CacheLoaded)
+    LoadCacheFile();
+  auto it = g_Cache.find(MakeKey(key));
+  if (it == g_Cache.end())
+    return false;
+  it->second.used = true;
+  entry = it->second.entry;
+  return true;
+}
+
+void PatchCacheStore(const PatchCacheKey &key, const PatchCacheEntry &entry) {
+  std::lock_guard<std::mutex> guard(g_CacheLock);
+  if (!g_CacheLoaded)
+    LoadCacheFile();
+  CacheRecord &record = g_Cache[MakeKey(key)];
+  record.entry = entry;
+  record.used = true;
+  g_CacheDirty = true;
+}
+
+void SavePatchCache() {
+  std::lock_guard<std::mutex> guard(g_CacheLock);
+  if (!g_CacheDirty)
+    return;
+  g_CacheDirty = false;
+
+  bool trim = g_Cache.size() > PATCHCACHE_MAX_ENTRIES;
+  std::vector<char> raw;
+  for (const auto &kv : g_Cache) {
+    if (trim && !kv.second.used)
+      continue;
+    const PatchCacheEntry &e = kv.second.entry;
+    PutString(raw, kv.first);
+    raw.insert(raw.end(), (const char *)&e.headDelta,
+               (const char *)&e.headDelta + sizeof(e.headDelta));
+    PutString(raw, e.oldDisasm);
+    PutString(raw, e.disasm);
+    PutString(raw, e.comment);
+  }
+  if (raw.size() > PATCHCACHE_MAX_RAW_SIZE)
+    return;
+
+  std::vector<char> packed(LZ4_compressBound((int)raw.size()) + 1);
+  int packedSize = 0;
+  if (!raw.empty()) {
+    packedSize = LZ4_compress(raw.data(), packed.data(), (int)raw.size());
+    if (packedSize <= 0)
+      return;
+  }
+
+  FILE *fp = fopen(CachePath().c_str(), "wb");
+  if (!fp)
+    return;
+  CacheFileHeader header = {PATCHCACHE_MAGIC, (uint32_t)raw.size(),
+                            (uint32_t)packedSize};
+  fwrite(&header, sizeof(header), 1, fp);
+  fwrite(packed.data(), 1, packedSize, fp);
+  fclose(fp);
+}
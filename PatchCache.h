@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+
+// On-disk cache of finished groups: instruction head, old/new disassembly
+// and comment. Entries are keyed by module name, RVA and a hash of the
+// original and current code around the patch, so they survive ASLR and
+// restarts and go stale on their own when the code or a patch near it
+// changes. Text is stored base-independent by the caller (PatchSync), so a
+// hit needs no decoding at all. The file is only read when the first lookup
+// happens and entries are checked one by one as groups ask for them. Stored
+// next to the plugin as PatchKing.cache, lz4-compressed. Thread-safe.
+
+struct PatchCacheKey {
+  std::string module; // Lower case
+  uint64_t rva;       // Patch address - module base
+  uint64_t hash;      // Old and current code around the patch
+};
+
+struct PatchCacheEntry {
+  int32_t headDelta; // head - address
+  std::string oldDisasm;
+  std::string disasm;
+  std::string comment;
+};
+
+bool PatchCacheLookup(const PatchCacheKey &key, PatchCacheEntry &entry);
+void PatchCacheStore(const PatchCacheKey &key, const PatchCacheEntry &entry);
+
+// Write the cache file if anything was added since the last save
+void SavePatchCache();
@@ -0,0 +1,370 @@
+#include "PatchFilter.h"
+#include "MemCache.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+// Bounds for FilterCache; the oldest results go first
+#define FILTERCACHE_MAX_ENTRIES 32
+#define FILTERCACHE_MAX_INDICES (4 * 1024 * 1024)
+
+bool PatchFilter::Compile(const char *oldPattern, bool invOld,
+                          const char *newPattern, bool invNew) {
+  std::string oldText = oldPattern ? oldPattern : "";
+  std::string newText = newPattern ? newPattern : "";
+  m_invOld = invOld;
+  m_invNew = invNew;
+  m_hasOld = m_hasNew = false;
+  m_query = PatchQuery();
+  if (!m_query.Parse(oldText) || !m_query.Parse(newText)) {
+    m_query = PatchQuery();
+    return false;
+  }
+
+  m_hasOld = !oldText.empty();
+  m_hasNew = !newText.empty();
+  if (!m_hasOld && !m_hasNew && m_query.Empty())
+    return false;
+
+  if (!m_old.Compile(oldText.c_str()) || !m_new.Compile(newText.c_str())) {
+    m_hasOld = m_hasNew = false;
+    m_query = PatchQuery();
+    return false;
+  }
+  return true;
+}
+
+bool PatchFilter::Matches(const PatchStore &store, size_t i) const {
+  if (!m_query.Matches(store, i))
+    return false;
+  if (m_hasOld) {
+    bool matchOld =
+        m_old.Search(store.FoldedOldDisasm(i)) ||
+        m_old.Search(store.FoldedComment(i));
+    if (matchOld == m_invOld)
+      return false;
+  }
+  if (m_hasNew) {
+    bool matchNew = m_new.Search(store.FoldedDisasm(i));
+    if (matchNew == m_invNew)
+      return false;
+  }
+  return true;
+}
+
+// One box: does (has, inv, matcher) accept a subset of what the broader
+// box accepts? With inversion the subset relation flips.
+static bool BoxNarrows(bool has, bool inv, const TextMatcher &m,
+                       bool broaderHas, bool broaderInv,
+                       const TextMatcher &broader) {
+  if (!broaderHas)
+    return true;
+  if (!has || inv != broaderInv)
+    return false;
+  return inv ? broader.Refines(m) : m.Refines(broader);
+}
+
+bool PatchFilter::Narrows(const PatchFilter &broader) const {
+  return m_query.Narrows(broader.m_query) &&
+         BoxNarrows(m_hasOld, m_invOld, m_old, broader.m_hasOld,
+                    broader.m_invOld, broader.m_old) &&
+         BoxNarrows(m_hasNew, m_invNew, m_new, broader.m_hasNew,
+                    broader.m_invNew, broader.m_new);
+}
+
+bool PatchFilter::SameAs(const PatchFilter &other) const {
+  auto sameBox = [](bool has, bool inv, const TextMatcher &m, bool otherHas,
+                    bool otherInv, const TextMatcher &o) {
+    if (has != otherHas)
+      return false;
+    return !has || (inv == otherInv && m.GetPattern() == o.GetPattern());
+  };
+  return m_query.SameAs(other.m_query) &&
+         sameBox(m_hasOld, m_invOld, m_old, other.m_hasOld, other.m_invOld,
+                 other.m_old) &&
+         sameBox(m_hasNew, m_invNew, m_new, other.m_hasNew, other.m_invNew,
+                 other.m_new);
+}
+
+bool PatchFilter::IndexCandidates(const PatchStore &store,
+                                  PatchView &rows) const {
+  const TrigramIndex &index = store.Trigrams();
+  std::vector<std::vector<std::string>> anyOf;
+  PatchView found, both;
+  bool narrowed = false;
+  // Intersect 'found' into 'rows'
+  auto narrow = [&]() {
+    if (narrowed) {
+      both.clear();
+      std::set_intersection(rows.begin(), rows.end(), found.begin(),
+                            found.end(), std::back_inserter(both));
+      rows.swap(both);
+    } else {
+      rows.swap(found);
+      narrowed = true;
+    }
+  };
+  auto lookup = [&](const TextMatcher &m, int fields) {
+    if (m.RequiredLiterals(anyOf) && index.Lookup(fields, anyOf, found))
+      narrow();
+  };
+
+  // An inverted box matches rows *without* the text, so it can't narrow
+  if (m_hasOld && !m_invOld)
+    lookup(m_old, TrigramIndex::FIELD_OLD);
+  if (m_hasNew && !m_invNew)
+    lookup(m_new, TrigramIndex::FIELD_NEW);
+  for (const auto &m : m_query.TextTerms())
+    lookup(m, TrigramIndex::FIELD_OLD | TrigramIndex::FIELD_NEW);
+  if (m_query.ByteCandidates(store, found))
+    narrow();
+  return narrowed;
+}
+
+void FilterCache::Clear() {
+  m_entries.clear();
+  m_indices = 0;
+}
+
+// Rows between two checks of the cancel flag
+#define FILTER_CANCEL_STRIDE 4096
+// Rows per parallel chunk; small lists are filtered on the calling thread
+#define FILTER_CHUNK_SIZE 16384
+// Below this many candidate rows, checking them beats an index lookup
+#define FILTER_INDEX_MIN_ROWS 4096
+
+// Evaluate 'filter' for candidates [0, count) on the thread pool. Chunks are
+// filtered independently and concatenated in order, so the result keeps the
+// store's address order. 'index(k)' maps a candidate to its store index.
+template <typename IndexFn>
+static bool FilterParallel(const PatchStore &store, const PatchFilter &filter,
+                           size_t count, IndexFn index, PatchView &view,
+                           const std::atomic<bool> *cancel) {
+  size_t chunks = (count + FILTER_CHUNK_SIZE - 1) / FILTER_CHUNK_SIZE;
+  std::vector<PatchView> parts(chunks);
+  std::atomic<bool> stopped{false};
+  ParallelFor(chunks, 1, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; ++c) {
+      size_t first = c * FILTER_CHUNK_SIZE;
+      size_t last = first + FILTER_CHUNK_SIZE < count
+                        ? first + FILTER_CHUNK_SIZE
+                        : count;
+      PatchView &part = parts[c];
+      for (size_t k = first; k < last; ++k) {
+        if (k % FILTER_CANCEL_STRIDE == 0 &&
+            (stopped || (cancel && *cancel))) {
+          stopped = true;
+          return;
+        }
+        uint32_t i = index(k);
+        if (filter.Matches(store, i))
+          part.push_back(i);
+      }
+    }
+  });
+  if (stopped)
+    return false;
+
+  size_t total = 0;
+  for (const auto &part : parts)
+    total += part.size();
+  view.clear();
+  view.reserve(total);
+  for (const auto &part : parts)
+    view.insert(view.end(), part.begin(), part.end());
+  return true;
+}
+
+bool FilterCache::Apply(const PatchStore &store, const PatchFilter &filter,
+                        PatchView &view, const std::atomic<bool> *cancel) {
+  if (m_generation != store.Generation()) {
+    Clear();
+    m_generation = store.Generation();
+  }
+
+  // Results of state: queries only hold until memory changes
+  unsigned int epoch = MemCacheEpoch();
+  auto current = [epoch](const Entry &e) {
+    return !e.memEpoch || e.memEpoch == epoch;
+  };
+
+  // Same filter as before (backspace, toggling a checkbox back)
+  for (size_t k = m_entries.size(); k-- > 0;) {
+    if (current(m_entries[k]) && m_entries[k].filter.SameAs(filter)) {
+      view = m_entries[k].view;
+      return true;
+    }
+  }
+
+  // Smallest earlier result this filter narrows
+  const PatchView *base = NULL;
+  for (const auto &e : m_entries) {
+    if (current(e) && filter.Narrows(e.filter) &&
+        (!base || e.view.size() < base->size()))
+      base = &e.view;
+  }
+
+  // Address and module terms: only rows in their index ranges can match
+  std::vector<IndexRange> ranges;
+  PatchView candidates;
+  if (filter.Candidates(store, ranges)) {
+    for (const auto &r : ranges) {
+      if (base) {
+        auto first = std::lower_bound(base->begin(), base->end(),
+                                      (uint32_t)r.begin);
+        auto last = std::lower_bound(first, base->end(), (uint32_t)r.end);
+        candidates.insert(candidates.end(), first, last);
+      } else {
+        for (size_t i = r.begin; i < r.end; ++i)
+          candidates.push_back((uint32_t)i);
+      }
+    }
+    base = &candidates;
+  }
+
+  // Text and byte patterns: rows holding their trigrams or bytes
+  PatchView rows;
+  if ((!base || base->size() >= FILTER_INDEX_MIN_ROWS) &&
+      filter.IndexCandidates(store, rows)) {
+    if (base) {
+      PatchView both;
+      std::set_intersection(base->begin(), base->end(), rows.begin(),
+                            rows.end(), std::back_inserter(both));
+      candidates.swap(both);
+    } else {
+      candidates.swap(rows);
+    }
+    base = &candidates;
+  }
+
+  bool done;
+  if (base) {
+    done = FilterParallel(
+        store, filter, base->size(),
+        [base](size_t k) { return (*base)[k]; }, view, cancel);
+  } else {
+    done = FilterParallel(
+        store, filter, store.size(), [](size_t k) { return (uint32_t)k; },
+        view, cancel);
+  }
+  if (!done)
+    return false;
+
+  m_entries.push_back({filter, view, filter.UsesMemory() ? epoch : 0});
+  m_indices += view.size();
+  while (m_entries.size() > FILTERCACHE_MAX_ENTRIES ||
+         (m_indices > FILTERCACHE_MAX_INDICES && m_entries.size() > 1)) {
+    m_indices -= m_entries.front().view.size();
+    m_entries.erase(m_entries.begin());
+  }
+  return true;
+}
+
+// --- Filter worker ---
+
+struct FilterRequest {
+  HWND notifyWnd;
+  const PatchStore *store;
+  PatchFilter filter;
+  uint32_t pass;
+};
+
+static std::mutex g_FilterLock; // Guards everything below
+static std::condition_variable g_FilterWake;
+static std::condition_variable g_FilterIdle;
+static std::thread g_FilterThread;
+static bool g_FilterStop = false;
+static bool g_FilterBusy = false;     // Worker is inside a pass
+static bool g_FilterPending = false;  // g_FilterRequest not yet taken
+static FilterRequest g_FilterRequest;
+static uint32_t g_FilterPass = 0;     // Newest pass started
+static uint32_t g_FilterDonePass = 0; // Pass whose result is in g_FilterResult
+static PatchView g_FilterResult;
+
+static std::atomic<bool> g_FilterCancel{false};
+static FilterCache g_FilterCache; // Used by whoever is filtering
+
+static void FilterWorker() {
+  std::unique_lock<std::mutex> lock(g_FilterLock);
+  while (true) {
+    g_FilterWake.wait(lock, [] { return g_FilterStop || g_FilterPending; });
+    if (g_FilterStop)
+      return;
+    FilterRequest request = g_FilterRequest;
+    g_FilterPending = false;
+    g_FilterBusy = true;
+    g_FilterCancel = false;
+    lock.unlock();
+
+    PatchView view;
+    bool done = g_FilterCache.Apply(*request.store, request.filter, view,
+                                    &g_FilterCancel);
+
+    lock.lock();
+    g_FilterBusy = false;
+    g_FilterIdle.notify_all();
+    if (done && request.pass == g_FilterPass) {
+      g_FilterResult.swap(view);
+      g_FilterDonePass = request.pass;
+      PostMessage(request.notifyWnd, WM_PATCH_FILTERED, (WPARAM)request.pass,
+                  0);
+    }
+  }
+}
+
+uint32_t StartFilterPass(HWND notifyWnd, const PatchStore &store,
+                         const PatchFilter &filter) {
+  std::lock_guard<std::mutex> guard(g_FilterLock);
+  if (!g_FilterThread.joinable()) {
+    g_FilterStop = false;
+    g_FilterThread = std::thread(FilterWorker);
+  }
+  g_FilterCancel = true; // Newer keystroke wins
+  g_FilterRequest = {notifyWnd, &store, filter, ++g_FilterPass};
+  g_FilterPending = true;
+  g_FilterWake.notify_one();
+  return g_FilterPass;
+}
+
+bool CollectFilterPass(uint32_t pass, PatchView &view) {
+  std::lock_guard<std::mutex> guard(g_FilterLock);
+  if (pass != g_FilterPass || pass != g_FilterDonePass)
+    return false;
+  view.swap(g_FilterResult);
+  g_FilterResult.clear();
+  g_FilterDonePass = 0;
+  return true;
+}
+
+void CancelFilterPass() {
+  std::unique_lock<std::mutex> lock(g_FilterLock);
+  g_FilterPending = false;
+  g_FilterCancel = true;
+  ++g_FilterPass; // Results still on their way are stale
+  g_FilterIdle.wait(lock, [] { return !g_FilterBusy; });
+  g_FilterResult.clear();
+  g_FilterDonePass = 0;
+}
+
+void FilterNow(const PatchStore &store, const PatchFilter &filter,
+               PatchView &view) {
+  CancelFilterPass();
+  // The worker is idle and nothing is pending, so the cache is ours
+  g_FilterCache.Apply(store, filter, view);
+}
+
+void ShutdownFilterWorker() {
+  {
+    std::lock_guard<std::mutex> guard(g_FilterLock);
+    g_FilterStop = true;
+    g_FilterCancel = true;
+    g_FilterPending = false;
+  }
+  g_FilterWake.notify_all();
+  if (g_FilterThread.joinable())
+    g_FilterThread.join();
+  g_FilterCache.Clear();
+}
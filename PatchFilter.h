@@ -0,0 +1,98 @@
+#pragma once
+#include "PatchQuery.h"
+#include "PatchStore.h"
+#include "TextMatcher.h"
+#include <atomic>
+#include <windows.h>
+
+// Posted to the notify window when a filter pass finishes; wParam is the
+// pass number returned by StartFilterPass
+#define WM_PATCH_FILTERED (WM_APP + 3)
+
+// The two filter boxes of the patch window, compiled once per pass.
+// The "Old" pattern is matched against the old disassembly and the comment,
+// the "New" pattern against the new disassembly; each can be inverted.
+// Query terms (see PatchQuery) typed into either box are taken out first and
+// always apply; inversion only flips the free text around them.
+class PatchFilter {
+public:
+  // Returns false if the filter is empty or invalid (everything matches)
+  bool Compile(const char *oldPattern, bool invOld, const char *newPattern,
+               bool invNew);
+
+  bool Matches(const PatchStore &store, size_t i) const;
+
+  // Every group this filter accepts is also accepted by 'broader'
+  bool Narrows(const PatchFilter &broader) const;
+
+  bool SameAs(const PatchFilter &other) const;
+
+  // See PatchQuery::Candidates
+  bool Candidates(const PatchStore &store,
+                  std::vector<IndexRange> &ranges) const {
+    return m_query.Candidates(store, ranges);
+  }
+
+  // Rows that can match according to the store's trigram index and a scan
+  // of its byte arena, sorted. Returns false if neither has anything to
+  // look up (no non-inverted pattern, no byte term).
+  bool IndexCandidates(const PatchStore &store, PatchView &rows) const;
+
+  bool UsesMemory() const { return m_query.UsesMemory(); }
+
+private:
+  bool m_hasOld = false;
+  bool m_hasNew = false;
+  bool m_invOld = false;
+  bool m_invNew = false;
+  TextMatcher m_old;
+  TextMatcher m_new;
+  PatchQuery m_query;
+};
+
+// Remembers recent filter results so typing stays cheap on large lists.
+// A pattern that narrows an earlier one (typing "cal" -> "call") only
+// rescans that earlier result, and going back to an earlier pattern
+// (backspace) returns its result directly. Results are dropped as soon as
+// the store changes, or debuggee memory does for state: queries.
+class FilterCache {
+public:
+  // Fill 'view' with the indices of 'store' accepted by 'filter'. Returns
+  // false (and caches nothing) if 'cancel' was raised along the way.
+  bool Apply(const PatchStore &store, const PatchFilter &filter,
+             PatchView &view, const std::atomic<bool> *cancel = NULL);
+  void Clear();
+
+private:
+  struct Entry {
+    PatchFilter filter;
+    PatchView view;
+    unsigned int memEpoch; // MemCacheEpoch() if the filter reads memory
+  };
+  std::vector<Entry> m_entries; // Oldest first
+  size_t m_indices = 0;         // Total size of all cached views
+  uint32_t m_generation = 0;
+};
+
+// Filtering on a background worker so typing never waits for a pass.
+// Starting a pass cancels the one in flight; only the newest finished pass
+// can be collected. The worker reads the store without locking, so callers
+// must cancel any pass before modifying the store it was given.
+
+// Returns the pass number posted with WM_PATCH_FILTERED
+uint32_t StartFilterPass(HWND notifyWnd, const PatchStore &store,
+                         const PatchFilter &filter);
+
+// Move the result of pass 'pass' into 'view'. False if a newer pass was
+// started or the pass was cancelled.
+bool CollectFilterPass(uint32_t pass, PatchView &view);
+
+// Cancel the pass in flight and wait for the worker to let go of the store
+void CancelFilterPass();
+
+// Filter on the calling thread (cancels any pass first), sharing the cache
+void FilterNow(const PatchStore &store, const PatchFilter &filter,
+               PatchView &view);
+
+// Join the worker (window close)
+void ShutdownFilterWorker();
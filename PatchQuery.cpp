@@ -0,0 +1,515 @@
+#include "PatchQuery.h"
+#include "PatchState.h"
+#include <algorithm>
+#include <ctype.h>
+#include <iterator>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PATCHQUERY_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static const char *const g_QueryKeys[] = {
+    "mod:", "addr:", "size", "state:", "bytes:", "oldbytes:", "text:"};
+
+// Key that 'token' starts with (case-insensitive); NULL if none. "size" has
+// to be followed by its comparison operator.
+static const char *MatchKey(const char *token) {
+  for (const char *key : g_QueryKeys) {
+    size_t len = strlen(key);
+    size_t i = 0;
+    while (i < len && tolower((unsigned char)token[i]) == key[i])
+      ++i;
+    if (i < len)
+      continue;
+    if (key[len - 1] != ':' && (!token[len] || !strchr("<>=:", token[len])))
+      continue;
+    return key;
+  }
+  return NULL;
+}
+
+static bool ParseNumber(const std::string &s, unsigned long long &value,
+                        int base) {
+  const char *p = s.c_str();
+  if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+    p += 2;
+    base = 16;
+  }
+  if (!*p)
+    return false;
+  value = 0;
+  for (; *p; ++p) {
+    int digit;
+    if (*p >= '0' && *p <= '9')
+      digit = *p - '0';
+    else if (base == 16 && isxdigit((unsigned char)*p))
+      digit = tolower((unsigned char)*p) - 'a' + 10;
+    else
+      return false;
+    if (value > (~0ULL - digit) / base)
+      return false; // Overflow
+    value = value * base + digit;
+  }
+  return true;
+}
+
+static bool ParseAddress(const std::string &s, duint &addr) {
+  unsigned long long value;
+  if (!ParseNumber(s, value, 16) || value > (duint)-1)
+    return false;
+  addr = (duint)value;
+  return true;
+}
+
+static void SplitList(const std::string &s, std::vector<std::string> &parts) {
+  size_t start = 0;
+  while (true) {
+    size_t comma = s.find(',', start);
+    parts.push_back(s.substr(start, comma - start));
+    if (comma == std::string::npos)
+      break;
+    start = comma + 1;
+  }
+}
+
+static int HexNibble(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  c = (char)tolower((unsigned char)c);
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+// "E8??", "EB ?? 90", "7?": two nibbles per byte, '?' matches any nibble,
+// blanks are ignored (x64dbg pattern syntax)
+static bool ParseBytePattern(const std::string &s,
+                             std::vector<unsigned char> &value,
+                             std::vector<unsigned char> &mask) {
+  std::string nibbles;
+  for (char c : s) {
+    if (!isspace((unsigned char)c))
+      nibbles.push_back(c);
+  }
+  if (nibbles.empty() || nibbles.size() % 2)
+    return false;
+  for (size_t k = 0; k < nibbles.size(); k += 2) {
+    unsigned char v = 0, m = 0;
+    for (int half = 0; half < 2; ++half) {
+      char c = nibbles[k + half];
+      int shift = half ? 0 : 4;
+      if (c == '?')
+        continue;
+      int nibble = HexNibble(c);
+      if (nibble < 0)
+        return false;
+      v |= (unsigned char)(nibble << shift);
+      m |= (unsigned char)(0xF << shift);
+    }
+    value.push_back(v);
+    mask.push_back(m);
+  }
+  return true;
+}
+
+bool PatchQuery::AddTerm(const std::string &key, const std::string &value) {
+  if (key == "addr:") {
+    size_t dash = value.find('-');
+    duint begin, end;
+    if (!ParseAddress(value.substr(0, dash), begin))
+      return false;
+    if (dash == std::string::npos) {
+      end = begin + 1 ? begin + 1 : begin; // Wraps only at the very top
+    } else if (!ParseAddress(value.substr(dash + 1), end) || end <= begin) {
+      return false;
+    }
+    if (m_hasAddr) {
+      begin = std::max(begin, m_addrBegin);
+      end = std::max(begin, std::min(end, m_addrEnd));
+    }
+    m_hasAddr = true;
+    m_addrBegin = begin;
+    m_addrEnd = end;
+    return true;
+  }
+
+  if (key == "mod:") {
+    std::vector<std::string> names;
+    std::vector<ModuleId> ids, found;
+    SplitList(value, names);
+    for (const auto &name : names) {
+      if (name.empty())
+        return false;
+      FindModulesNoCase(name.c_str(), found);
+      ids.insert(ids.end(), found.begin(), found.end());
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    if (m_hasModule) {
+      std::vector<ModuleId> both;
+      std::set_intersection(ids.begin(), ids.end(), m_modules.begin(),
+                            m_modules.end(), std::back_inserter(both));
+      ids.swap(both);
+    }
+    m_hasModule = true;
+    m_modules.swap(ids);
+    return true;
+  }
+
+  if (key == "size") {
+    // 'value' still starts with the operator
+    std::string op = value.substr(0, value[1] == '=' ? 2 : 1);
+    unsigned long long n;
+    if (!ParseNumber(value.substr(op.size()), n, 10) || n >= (size_t)-1)
+      return false;
+    size_t size = (size_t)n;
+    if (op == ">") {
+      m_minSize = std::max(m_minSize, size + 1);
+    } else if (op == ">=") {
+      m_minSize = std::max(m_minSize, size);
+    } else if (op == "<") {
+      if (size == 0)
+        m_minSize = std::max(m_minSize, (size_t)1); // Nothing is smaller
+      m_maxSize = std::min(m_maxSize, size ? size - 1 : 0);
+    } else if (op == "<=") {
+      m_maxSize = std::min(m_maxSize, size);
+    } else if (op == "=" || op == ":" || op == "==") {
+      m_minSize = std::max(m_minSize, size);
+      m_maxSize = std::min(m_maxSize, size);
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  if (key == "state:") {
+    std::vector<std::string> names;
+    unsigned int states = 0;
+    SplitList(value, names);
+    for (auto name : names) {
+      std::transform(name.begin(), name.end(), name.begin(),
+                     [](char c) { return (char)tolower((unsigned char)c); });
+      if (name == "applied")
+        states |= STATE_APPLIED;
+      else if (name == "restored")
+        states |= STATE_RESTORED;
+      else if (name == "modified")
+        states |= STATE_MODIFIED;
+      else
+        return false;
+    }
+    m_states &= states;
+    return true;
+  }
+
+  if (key == "bytes:" || key == "oldbytes:") {
+    std::string body = value;
+    BytePattern pattern;
+    pattern.oldBytes = key == "oldbytes:";
+    pattern.atStart = !body.empty() && body.front() == '^';
+    if (pattern.atStart)
+      body.erase(0, 1);
+    pattern.atEnd = !body.empty() && body.back() == '$';
+    if (pattern.atEnd)
+      body.pop_back();
+    if (!ParseBytePattern(body, pattern.value, pattern.mask))
+      return false;
+    m_bytes.push_back(pattern);
+    return true;
+  }
+
+  if (key == "text:") {
+    std::string pattern;
+    if (value.size() >= 2 && value.front() == '/' && value.back() == '/') {
+      // Regex between the slashes; "\/" is a slash
+      for (size_t k = 1; k + 1 < value.size(); ++k) {
+        if (value[k] == '\\' && value[k + 1] == '/' && k + 2 < value.size())
+          ++k;
+        pattern.push_back(value[k]);
+      }
+    } else {
+      // Plain word: escape it so TextMatcher keeps it literal
+      for (char c : value) {
+        if (strchr(".^$*+?()[]{}|\\/", c))
+          pattern.push_back('\\');
+        pattern.push_back(c);
+      }
+    }
+    TextMatcher matcher;
+    if (pattern.empty() || !matcher.Compile(pattern.c_str()))
+      return false;
+    m_text.push_back(matcher);
+    return true;
+  }
+  return false;
+}
+
+bool PatchQuery::Parse(std::string &text) {
+  size_t pos = 0;
+  while (pos < text.size()) {
+    if (isspace((unsigned char)text[pos])) {
+      ++pos;
+      continue;
+    }
+
+    const char *key = MatchKey(text.c_str() + pos);
+    size_t valueStart = pos + (key ? strlen(key) : 0);
+    size_t end = valueStart;
+    if (key && !strcmp(key, "text:") && text[valueStart] == '/') {
+      // A /regex/ may contain spaces; it ends at the next unescaped slash
+      for (end = valueStart + 1; end < text.size() && text[end] != '/';
+           ++end) {
+        if (text[end] == '\\' && end + 1 < text.size())
+          ++end;
+      }
+      if (end < text.size())
+        ++end;
+    } else if (key && text[valueStart] == '"') {
+      end = text.find('"', valueStart + 1);
+      end = end == std::string::npos ? text.size() : end + 1;
+    }
+    while (end < text.size() && !isspace((unsigned char)text[end]))
+      ++end;
+    if (!key) {
+      pos = end; // Free text
+      continue;
+    }
+
+    std::string value = text.substr(valueStart, end - valueStart);
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+      value = value.substr(1, value.size() - 2);
+    if (!AddTerm(key, value))
+      return false;
+    m_terms.push_back(text.substr(pos, end - pos));
+    // Drop the term and the blanks after it so "mov mod:x eax" reads
+    // "mov eax". A term ending the text takes the blanks before it
+    // instead, so "mov mod:x" reads "mov"; blanks the user typed after free
+    // text stay, "push " isn't "push".
+    while (end < text.size() && isspace((unsigned char)text[end]))
+      ++end;
+    if (end == text.size()) {
+      while (pos > 0 && isspace((unsigned char)text[pos - 1]))
+        --pos;
+    }
+    text.erase(pos, end - pos);
+  }
+
+  std::sort(m_terms.begin(), m_terms.end());
+  return true;
+}
+
+#ifdef PATCHQUERY_SSE2
+static inline unsigned int LowestBit(unsigned int mask) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (unsigned int)index;
+#else
+  return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Call hit(offset), in order, for every offset of 'data' where
+// (data[offset] & mask1) == value1 and (data[offset + dist] & mask2) ==
+// value2. Testing the pattern's first and last fixed byte together keeps
+// false hits rare; SSE2 tests 16 offsets per step.
+template <typename Fn>
+static void ScanMasked(const unsigned char *data, size_t size,
+                       unsigned char value1, unsigned char mask1,
+                       unsigned char value2, unsigned char mask2, size_t dist,
+                       Fn hit) {
+  if (size <= dist)
+    return;
+  size_t last = size - dist; // Offsets [0, last) can hold a hit
+  size_t i = 0;
+#ifdef PATCHQUERY_SSE2
+  const __m128i vValue1 = _mm_set1_epi8((char)value1);
+  const __m128i vMask1 = _mm_set1_epi8((char)mask1);
+  const __m128i vValue2 = _mm_set1_epi8((char)value2);
+  const __m128i vMask2 = _mm_set1_epi8((char)mask2);
+  for (; i + 16 <= last; i += 16) {
+    __m128i first =
+        _mm_and_si128(_mm_loadu_si128((const __m128i *)(data + i)), vMask1);
+    __m128i second = _mm_and_si128(
+        _mm_loadu_si128((const __m128i *)(data + i + dist)), vMask2);
+    unsigned int bits = (unsigned int)_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(first, vValue1),
+                      _mm_cmpeq_epi8(second, vValue2)));
+    while (bits) {
+      hit(i + LowestBit(bits));
+      bits &= bits - 1;
+    }
+  }
+#endif
+  for (; i < last; ++i) {
+    if ((data[i] & mask1) == value1 && (data[i + dist] & mask2) == value2)
+      hit(i);
+  }
+}
+
+bool PatchQuery::MatchesBytes(const BytePattern &p, const unsigned char *data,
+                              size_t size) {
+  size_t count = p.value.size();
+  if (count > size)
+    return false;
+  size_t first = p.atEnd ? size - count : 0;
+  size_t last = p.atStart ? 0 : size - count;
+  for (size_t start = first; start <= last; ++start) {
+    size_t k = 0;
+    while (k < count && (data[start + k] & p.mask[k]) == p.value[k])
+      ++k;
+    if (k == count)
+      return true;
+  }
+  return false;
+}
+
+// Same classification as the row colours: new bytes in memory, else old
+// bytes, else modified (includes unreadable memory)
+unsigned int PatchQuery::ReadState(const PatchStore &store, size_t i) const {
+  switch (ReadPatchState(store, i)) {
+  case PATCH_APPLIED:
+    return STATE_APPLIED;
+  case PATCH_ORIGINAL:
+    return STATE_RESTORED;
+  default:
+    return STATE_MODIFIED;
+  }
+}
+
+bool PatchQuery::Matches(const PatchStore &store, size_t i) const {
+  if (m_hasAddr &&
+      (store.End(i) <= m_addrBegin || store.Address(i) >= m_addrEnd))
+    return false;
+  if (m_hasModule && std::find(m_modules.begin(), m_modules.end(),
+                               store.Module(i)) == m_modules.end())
+    return false;
+
+  size_t count = store.ByteCount(i);
+  if (count < m_minSize || count > m_maxSize)
+    return false;
+  for (const auto &p : m_bytes) {
+    if (!MatchesBytes(p, p.oldBytes ? store.OldBytes(i) : store.NewBytes(i),
+                      count))
+      return false;
+  }
+
+  for (const auto &m : m_text) {
+    if (!m.Search(store.FoldedOldDisasm(i)) &&
+        !m.Search(store.FoldedComment(i)) && !m.Search(store.FoldedDisasm(i)))
+      return false;
+  }
+
+  // Memory reads last
+  if (m_states != STATE_ALL && !(ReadState(store, i) & m_states))
+    return false;
+  return true;
+}
+
+bool PatchQuery::Candidates(const PatchStore &store,
+                            std::vector<IndexRange> &ranges) const {
+  if (!m_hasAddr && !m_hasModule)
+    return false;
+
+  ranges.clear();
+  if (m_hasModule) {
+    for (ModuleId id : m_modules)
+      store.ModuleRanges(id, ranges);
+    std::sort(ranges.begin(), ranges.end(),
+              [](const IndexRange &a, const IndexRange &b) {
+                return a.begin < b.begin;
+              });
+  } else {
+    ranges.push_back({0, store.size()});
+  }
+
+  if (m_hasAddr) {
+    size_t first = store.LowerBoundEnd(m_addrBegin);
+    size_t last = store.LowerBoundAddress(m_addrEnd);
+    for (auto &r : ranges) {
+      r.begin = std::max(r.begin, first);
+      r.end = std::min(r.end, last);
+    }
+    ranges.erase(std::remove_if(ranges.begin(), ranges.end(),
+                                [](const IndexRange &r) {
+                                  return r.begin >= r.end;
+                                }),
+                 ranges.end());
+  }
+  return true;
+}
+
+// Scan the whole byte arena for the pattern's first and last fixed bytes
+// and map each hit back to its group, instead of visiting the groups one
+// by one
+void PatchQuery::ScanBytes(const PatchStore &store, const BytePattern &p,
+                           PatchView &rows) const {
+  size_t length = p.value.size();
+  size_t first = 0, last = length - 1;
+  while (!p.mask[first])
+    ++first;
+  while (!p.mask[last])
+    --last;
+
+  rows.clear();
+  size_t groups = store.size();
+  size_t row = 0;
+  ScanMasked(
+      store.ByteArena(), store.ByteArenaSize(), p.value[first], p.mask[first],
+      p.value[last], p.mask[last], last - first, [&](size_t offset) {
+        // Hits come in order, so the group cursor only moves forward
+        while (row + 1 < groups && store.BytesOffset(row + 1) <= offset)
+          ++row;
+        if (!rows.empty() && rows.back() == row)
+          return;
+        size_t count = store.ByteCount(row);
+        size_t side = store.BytesOffset(row) + (p.oldBytes ? 0 : count);
+        if (offset < side + first)
+          return;
+        size_t start = offset - side - first;
+        if (start + length > count)
+          return;
+        const unsigned char *data = store.ByteArena() + side + start;
+        for (size_t k = 0; k < length; ++k) {
+          if ((data[k] & p.mask[k]) != p.value[k])
+            return;
+        }
+        rows.push_back((uint32_t)row);
+      });
+}
+
+bool PatchQuery::ByteCandidates(const PatchStore &store,
+                                PatchView &rows) const {
+  PatchView found, both;
+  bool narrowed = false;
+  for (const auto &p : m_bytes) {
+    // Anchored patterns sit at a known offset, so checking each group is
+    // cheaper than visiting every hit; all-wildcard ones have nothing to
+    // scan for
+    if (p.atStart || p.atEnd ||
+        *std::max_element(p.mask.begin(), p.mask.end()) == 0)
+      continue;
+    ScanBytes(store, p, found);
+    if (narrowed) {
+      both.clear();
+      std::set_intersection(rows.begin(), rows.end(), found.begin(),
+                            found.end(), std::back_inserter(both));
+      rows.swap(both);
+    } else {
+      rows.swap(found);
+      narrowed = true;
+    }
+  }
+  return narrowed;
+}
+
+bool PatchQuery::Narrows(const PatchQuery &broader) const {
+  return std::includes(m_terms.begin(), m_terms.end(),
+                       broader.m_terms.begin(), broader.m_terms.end());
+}
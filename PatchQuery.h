@@ -0,0 +1,91 @@
+#pragma once
+#include "PatchStore.h"
+#include "TextMatcher.h"
+#include <string>
+#include <vector>
+
+// Structured terms typed into a filter box next to (or instead of) the
+// free-text pattern, e.g. "mod:game.dll addr:401000-402000 size>4 call".
+// Every term must hold; commas separate alternatives within one term.
+//   mod:NAME[,NAME]      module, case-insensitive, extension optional
+//   addr:A[-B]           group overlaps address A or the range [A, B), hex
+//   size>N, size<=N ...  group length in bytes (>, >=, <, <=, = or :)
+//   state:S[,S]          applied, restored or modified (neither), as shown
+//                        by the row colours; read from debuggee memory
+//   bytes:E8??           new bytes contain the pattern (x64dbg pattern
+//   oldbytes:"EB ?? 90"  syntax, '?' is a wildcard nibble); a leading '^'
+//                        or trailing '$' anchors it to the first or last
+//                        byte of the group
+//   text:WORD, text:/RE/ any of the three text columns
+// Values with spaces can be quoted.
+// Terms are evaluated cheapest first. Address and module terms are answered
+// by binary search over the address-sorted store and byte patterns by one
+// scan of its byte arena, so rows outside them are never looked at.
+class PatchQuery {
+public:
+  // Remove the terms from 'text', leaving its free-text part, and add them
+  // to the query. Returns false on a malformed term.
+  bool Parse(std::string &text);
+
+  bool Empty() const { return m_terms.empty(); }
+
+  // Result depends on debuggee memory, not only on the store
+  bool UsesMemory() const { return m_states != STATE_ALL; }
+
+  bool Matches(const PatchStore &store, size_t i) const;
+
+  // Index ranges of 'store' that can hold matches, in order. Returns false
+  // if the query doesn't narrow by index (every row is a candidate).
+  bool Candidates(const PatchStore &store,
+                  std::vector<IndexRange> &ranges) const;
+
+  // Rows whose bytes can match every unanchored byte term, sorted. Returns
+  // false if there is no such term with a fixed (or half-fixed) byte to
+  // scan for.
+  bool ByteCandidates(const PatchStore &store, PatchView &rows) const;
+
+  // Every term of 'broader' is also a term of this query
+  bool Narrows(const PatchQuery &broader) const;
+
+  bool SameAs(const PatchQuery &other) const { return m_terms == other.m_terms; }
+
+  // Matchers of the text: terms
+  const std::vector<TextMatcher> &TextTerms() const { return m_text; }
+
+private:
+  enum {
+    STATE_APPLIED = 1,
+    STATE_RESTORED = 2,
+    STATE_MODIFIED = 4,
+    STATE_ALL = 7
+  };
+
+  struct BytePattern {
+    std::vector<unsigned char> value;
+    std::vector<unsigned char> mask; // Bits that must match
+    bool oldBytes;                   // Search the old bytes, not the new
+    bool atStart;
+    bool atEnd;
+  };
+
+  static bool MatchesBytes(const BytePattern &p, const unsigned char *data,
+                           size_t size);
+  void ScanBytes(const PatchStore &store, const BytePattern &p,
+                 PatchView &rows) const;
+
+  bool AddTerm(const std::string &key, const std::string &value);
+  unsigned int ReadState(const PatchStore &store, size_t i) const;
+
+  std::vector<std::string> m_terms; // As typed, sorted
+
+  bool m_hasAddr = false;
+  duint m_addrBegin = 0;
+  duint m_addrEnd = 0;
+  bool m_hasModule = false;
+  std::vector<ModuleId> m_modules;
+  size_t m_minSize = 0;
+  size_t m_maxSize = (size_t)-1;
+  unsigned int m_states = STATE_ALL;
+  std::vector<BytePattern> m_bytes;
+  std::vector<TextMatcher> m_text;
+};
@@ -0,0 +1,82 @@
+#include "PatchRows.h"
+#include <iterator>
+
+static const char g_HexDigits[] = "0123456789abcdef";
+
+void FormatAddress(duint address, std::string &text) {
+  char buffer[2 * sizeof(duint)];
+  char *end = buffer + sizeof(buffer);
+  char *p = end;
+  do {
+    *--p = "0123456789ABCDEF"[address & 0xF];
+    address >>= 4;
+  } while (address);
+  text.assign(p, end);
+}
+
+void FormatBytes(const unsigned char *bytes, size_t size, std::string &text) {
+  text.assign(size ? size * 3 - 1 : 0, ' ');
+  for (size_t i = 0; i < size; ++i) {
+    text[i * 3] = g_HexDigits[bytes[i] >> 4];
+    text[i * 3 + 1] = g_HexDigits[bytes[i] & 0xF];
+  }
+}
+
+PatchRowCache::PatchRowCache(size_t capacity)
+    : m_capacity(capacity ? capacity : 1) {}
+
+void PatchRowCache::clear() {
+  m_rows.clear();
+  m_lookup.clear();
+  m_generation = 0;
+}
+
+const PatchRowCache::Row &PatchRowCache::Get(const PatchStore &store,
+                                             size_t index) {
+  if (store.Generation() != m_generation) {
+    clear();
+    m_generation = store.Generation();
+  }
+
+  auto it = m_lookup.find((uint32_t)index);
+  if (it != m_lookup.end()) {
+    if (it->second != m_rows.begin())
+      m_rows.splice(m_rows.begin(), m_rows, it->second);
+    return m_rows.front();
+  }
+
+  if (m_rows.size() >= m_capacity) {
+    // Reuse the least recently used row and its string buffers
+    m_lookup.erase(m_rows.back().index);
+    m_rows.splice(m_rows.begin(), m_rows, std::prev(m_rows.end()));
+  } else {
+    m_rows.emplace_front();
+  }
+  Row &row = m_rows.front();
+  row.index = (uint32_t)index;
+  FormatAddress(store.Address(index), row.address);
+  FormatBytes(store.OldBytes(index), store.ByteCount(index), row.oldBytes);
+  FormatBytes(store.NewBytes(index), store.ByteCount(index), row.newBytes);
+  m_lookup[row.index] = m_rows.begin();
+  return row;
+}
+
+const char *PatchRowCache::Text(const PatchStore &store, size_t index,
+                                PatchColumn column) {
+  switch (column) {
+  case COLUMN_OLD:
+    return store.OldDisasm(index);
+  case COLUMN_NEW:
+    return store.Disasm(index);
+  case COLUMN_COMMENT:
+    return store.Comment(index);
+  case COLUMN_ADDRESS:
+    return Get(store, index).address.c_str();
+  case COLUMN_OLD_BYTES:
+    return Get(store, index).oldBytes.c_str();
+  case COLUMN_NEW_BYTES:
+    return Get(store, index).newBytes.c_str();
+  default:
+    return "";
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "PatchStore.h"
+#include <list>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+// Columns of the patch list
+enum PatchColumn {
+  COLUMN_ADDRESS,
+  COLUMN_OLD_BYTES,
+  COLUMN_NEW_BYTES,
+  COLUMN_OLD,
+  COLUMN_NEW,
+  COLUMN_COMMENT,
+  COLUMN_COUNT
+};
+
+// Text of the patch list's cells for the owner-data ListView, which asks for
+// a cell only when it is about to be painted. The address and byte columns
+// are formatted on first request and the most recently used rows kept, so
+// repaints and scrolling back over the same rows cost a lookup; the text
+// columns come straight from the store. Knows nothing about windows, so it
+// can be driven without one.
+class PatchRowCache {
+public:
+  explicit PatchRowCache(size_t capacity);
+
+  // Text of a cell of group 'index'. Valid until the next call or until the
+  // store changes.
+  const char *Text(const PatchStore &store, size_t index, PatchColumn column);
+
+  void clear();
+  size_t size() const { return m_rows.size(); }
+
+private:
+  struct Row {
+    uint32_t index;
+    std::string address;
+    std::string oldBytes;
+    std::string newBytes;
+  };
+  typedef std::list<Row> RowList;
+
+  const Row &Get(const PatchStore &store, size_t index);
+
+  size_t m_capacity;
+  uint32_t m_generation = 0; // Of the store the rows were formatted from
+  RowList m_rows;            // Most recently used first
+  std::unordered_map<uint32_t, RowList::iterator> m_lookup;
+};
+
+// "401000"
+void FormatAddress(duint address, std::string &text);
+// "90 90 e8"
+void FormatBytes(const unsigned char *bytes, size_t size, std::string &text);
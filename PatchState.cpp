@@ -0,0 +1,98 @@
+#include "PatchState.h"
+#include "MemCache.h"
+#include <string.h>
+
+// Visible rows spanning more than this are read one group at a time
+#define STATE_BATCH_SPAN 0x10000
+
+static PatchState CompareState(const PatchStore &store, size_t i,
+                               const unsigned char *mem) {
+  size_t count = store.ByteCount(i);
+  if (memcmp(mem, store.NewBytes(i), count) == 0)
+    return PATCH_APPLIED;
+  if (memcmp(mem, store.OldBytes(i), count) == 0)
+    return PATCH_ORIGINAL;
+  return PATCH_MODIFIED;
+}
+
+PatchState ReadPatchState(const PatchStore &store, size_t i) {
+  size_t count = store.ByteCount(i);
+  if (count == 0)
+    return PATCH_MODIFIED;
+  unsigned char small[64];
+  std::vector<unsigned char> large;
+  unsigned char *mem = small;
+  if (count > sizeof(small)) {
+    large.resize(count);
+    mem = large.data();
+  }
+  if (!CachedMemRead(store.Address(i), mem, count))
+    return PATCH_UNREADABLE;
+  return CompareState(store, i, mem);
+}
+
+void PatchStateCache::Validate(const PatchStore &store) {
+  unsigned int epoch = MemCacheEpoch();
+  if (epoch == m_epoch && store.Generation() == m_generation &&
+      m_states.size() == store.size())
+    return;
+  m_epoch = epoch;
+  m_generation = store.Generation();
+  m_states.assign(store.size(), PATCH_STATE_UNKNOWN);
+}
+
+void PatchStateCache::Update(const PatchStore &store, const PatchView &view,
+                             size_t first, size_t last) {
+  Validate(store);
+  if (last > view.size())
+    last = view.size();
+
+  // The view is in address order: the rows to read lie between the first
+  // and the last unknown one
+  size_t lo = first, hi = last;
+  while (lo < hi && m_states[view[lo]] != PATCH_STATE_UNKNOWN)
+    ++lo;
+  while (hi > lo && m_states[view[hi - 1]] != PATCH_STATE_UNKNOWN)
+    --hi;
+  if (lo == hi)
+    return;
+
+  duint begin = store.Address(view[lo]);
+  duint end = begin;
+  for (size_t k = lo; k < hi; ++k) {
+    if (store.End(view[k]) > end)
+      end = store.End(view[k]);
+  }
+
+  // One read for the lot; a failure means some page is unreadable, so
+  // those rows are sorted out one by one below
+  bool batched = end - begin <= STATE_BATCH_SPAN;
+  if (batched) {
+    m_buffer.resize((size_t)(end - begin));
+    batched = CachedMemRead(begin, m_buffer.data(), end - begin);
+  }
+  for (size_t k = lo; k < hi; ++k) {
+    uint32_t i = view[k];
+    if (m_states[i] != PATCH_STATE_UNKNOWN)
+      continue;
+    if (batched && store.ByteCount(i) > 0)
+      m_states[i] = CompareState(store, i,
+                                 m_buffer.data() + (store.Address(i) - begin));
+    else
+      m_states[i] = ReadPatchState(store, i);
+  }
+}
+
+PatchState PatchStateCache::Get(const PatchStore &store, size_t i) {
+  Validate(store);
+  if (m_states[i] == PATCH_STATE_UNKNOWN)
+    m_states[i] = ReadPatchState(store, i);
+  return (PatchState)m_states[i];
+}
+
+void PatchStateCache::clear() {
+  m_states.clear();
+  m_buffer.clear();
+  m_epoch = 0;
+  m_generation = 0;
+}
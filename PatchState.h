@@ -0,0 +1,41 @@
+#pragma once
+#include "PatchStore.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// What debuggee memory holds at a patch group
+enum PatchState : uint8_t {
+  PATCH_STATE_UNKNOWN, // Not read yet (cache slot only)
+  PATCH_APPLIED,       // The new bytes
+  PATCH_ORIGINAL,      // The old bytes
+  PATCH_MODIFIED,      // Something else, e.g. changed outside the plugin
+  PATCH_UNREADABLE,    // Part of the group couldn't be read
+};
+
+// Read the state of group 'i' through the memory cache. Thread-safe.
+PatchState ReadPatchState(const PatchStore &store, size_t i);
+
+// States of the groups the list paints, kept for one memory cache epoch.
+// Update reads the visible rows in one pass (a single read when they lie
+// close together), so custom draw only looks up a byte per cell. Everything
+// is dropped when the epoch or the store changes. UI thread only.
+class PatchStateCache {
+public:
+  // Read the states of view[first, last) not known for this epoch yet
+  void Update(const PatchStore &store, const PatchView &view, size_t first,
+              size_t last);
+
+  // State of group 'i', read on the spot if Update didn't cover it
+  PatchState Get(const PatchStore &store, size_t i);
+
+  void clear();
+
+private:
+  void Validate(const PatchStore &store);
+
+  unsigned int m_epoch = 0;
+  uint32_t m_generation = 0;
+  std::vector<uint8_t> m_states; // By store index
+  std::vector<unsigned char> m_buffer;
+};
@@ -0,0 +1,201 @@
+#include "PatchStore.h"
+#include "TextMatcher.h"
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+#include <utility>
+
+static std::atomic<uint32_t> g_StoreGeneration{0};
+
+PatchStore::PatchStore() {
+  m_strings.push_back('\0');
+  m_folded.push_back('\0');
+  Touch();
+}
+
+void PatchStore::Touch() { m_generation = ++g_StoreGeneration; }
+
+void PatchStore::clear() {
+  m_address.clear();
+  m_head.clear();
+  m_bytesOffset.clear();
+  m_byteCount.clear();
+  m_flags.clear();
+  m_oldDisasm.clear();
+  m_disasm.clear();
+  m_comment.clear();
+  m_module.clear();
+  m_moduleRuns.clear();
+  m_bytes.clear();
+  m_strings.assign(1, '\0');
+  m_folded.assign(1, '\0');
+  m_trigrams.clear();
+  Touch();
+}
+
+void PatchStore::swap(PatchStore &other) {
+  m_address.swap(other.m_address);
+  m_head.swap(other.m_head);
+  m_bytesOffset.swap(other.m_bytesOffset);
+  m_byteCount.swap(other.m_byteCount);
+  m_flags.swap(other.m_flags);
+  m_oldDisasm.swap(other.m_oldDisasm);
+  m_disasm.swap(other.m_disasm);
+  m_comment.swap(other.m_comment);
+  m_module.swap(other.m_module);
+  m_moduleRuns.swap(other.m_moduleRuns);
+  m_bytes.swap(other.m_bytes);
+  m_strings.swap(other.m_strings);
+  m_folded.swap(other.m_folded);
+  m_trigrams.swap(other.m_trigrams);
+  std::swap(m_generation, other.m_generation);
+}
+
+uint32_t PatchStore::AddText(const std::string &text, bool ansi) {
+  if (text.empty())
+    return 0;
+  uint32_t offset = (uint32_t)m_strings.size();
+  m_strings.insert(m_strings.end(), text.c_str(),
+                   text.c_str() + text.size() + 1);
+  m_folded.insert(m_folded.end(), text.c_str(),
+                  text.c_str() + text.size() + 1);
+  if (ansi)
+    FoldAnsi(&m_folded[offset], text.size());
+  else
+    FoldAscii(&m_folded[offset], text.size());
+  return offset;
+}
+
+void PatchStore::AddModuleRun(size_t index, ModuleId module) {
+  if (m_moduleRuns.empty() || m_module[m_moduleRuns.back()] != module)
+    m_moduleRuns.push_back((uint32_t)index);
+}
+
+size_t PatchStore::Append(const PatchInfo &p) {
+  size_t count = p.oldBytes.size();
+  m_address.push_back(p.address);
+  m_head.push_back(p.head);
+  m_bytesOffset.push_back((uint32_t)m_bytes.size());
+  m_byteCount.push_back((uint32_t)count);
+  m_bytes.insert(m_bytes.end(), p.oldBytes.begin(), p.oldBytes.end());
+  // newBytes always has the same length as oldBytes (one entry per byte)
+  m_bytes.insert(m_bytes.end(), p.newBytes.begin(),
+                 p.newBytes.begin() + (p.newBytes.size() < count
+                                           ? p.newBytes.size()
+                                           : count));
+  m_bytes.resize(m_bytesOffset.back() + 2 * count, 0);
+  m_flags.push_back(p.active ? FLAG_ACTIVE : 0);
+  m_oldDisasm.push_back(AddText(p.oldDisasm, false));
+  m_disasm.push_back(AddText(p.disasm, false));
+  m_comment.push_back(AddText(p.comment, true));
+  m_module.push_back(p.module);
+  AddModuleRun(m_module.size() - 1, p.module);
+  size_t row = m_address.size() - 1;
+  m_trigrams.Add((uint32_t)row, FoldedOldDisasm(row), FoldedComment(row),
+                 FoldedDisasm(row));
+  Touch();
+  return row;
+}
+
+void PatchStore::Append(const PatchStore &other) {
+  if (other.empty())
+    return;
+  size_t indexBase = m_address.size();
+  uint32_t bytesBase = (uint32_t)m_bytes.size();
+  // Skip the leading "" of the other arena; offset 0 stays 0
+  uint32_t stringsBase = (uint32_t)m_strings.size() - 1;
+
+  m_address.insert(m_address.end(), other.m_address.begin(),
+                   other.m_address.end());
+  m_head.insert(m_head.end(), other.m_head.begin(), other.m_head.end());
+  m_byteCount.insert(m_byteCount.end(), other.m_byteCount.begin(),
+                     other.m_byteCount.end());
+  m_flags.insert(m_flags.end(), other.m_flags.begin(), other.m_flags.end());
+  m_module.insert(m_module.end(), other.m_module.begin(), other.m_module.end());
+  m_bytes.insert(m_bytes.end(), other.m_bytes.begin(), other.m_bytes.end());
+  m_strings.insert(m_strings.end(), other.m_strings.begin() + 1,
+                   other.m_strings.end());
+  m_folded.insert(m_folded.end(), other.m_folded.begin() + 1,
+                  other.m_folded.end());
+
+  for (uint32_t off : other.m_bytesOffset)
+    m_bytesOffset.push_back(bytesBase + off);
+  auto rebase = [&](std::vector<uint32_t> &dst,
+                    const std::vector<uint32_t> &src) {
+    for (uint32_t off : src)
+      dst.push_back(off ? stringsBase + off : 0);
+  };
+  rebase(m_oldDisasm, other.m_oldDisasm);
+  rebase(m_disasm, other.m_disasm);
+  rebase(m_comment, other.m_comment);
+  for (uint32_t run : other.m_moduleRuns)
+    AddModuleRun(indexBase + run, other.m_module[run]);
+  m_trigrams.Append(other.m_trigrams, (uint32_t)indexBase);
+  Touch();
+}
+
+PatchInfo PatchStore::Get(size_t i) const {
+  PatchInfo p;
+  p.address = Address(i);
+  p.head = Head(i);
+  p.oldBytes.assign(OldBytes(i), OldBytes(i) + ByteCount(i));
+  p.newBytes.assign(NewBytes(i), NewBytes(i) + ByteCount(i));
+  p.comment = Comment(i);
+  p.oldDisasm = OldDisasm(i);
+  p.disasm = Disasm(i);
+  p.active = Active(i);
+  p.module = Module(i);
+  return p;
+}
+
+bool PatchStore::IsSameGroup(size_t i, const PatchInfo &p) const {
+  size_t count = ByteCount(i);
+  return Address(i) == p.address && count == p.oldBytes.size() &&
+         count == p.newBytes.size() &&
+         memcmp(OldBytes(i), p.oldBytes.data(), count) == 0 &&
+         memcmp(NewBytes(i), p.newBytes.data(), count) == 0 &&
+         Module(i) == p.module;
+}
+
+void PatchStore::ModuleRanges(ModuleId module,
+                              std::vector<IndexRange> &ranges) const {
+  for (size_t r = 0; r < m_moduleRuns.size(); ++r) {
+    if (m_module[m_moduleRuns[r]] != module)
+      continue;
+    IndexRange range;
+    range.begin = m_moduleRuns[r];
+    range.end = r + 1 < m_moduleRuns.size() ? m_moduleRuns[r + 1] : size();
+    ranges.push_back(range);
+  }
+}
+
+size_t PatchStore::LowerBoundEnd(duint addr) const {
+  size_t lo = 0, hi = size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (End(mid) <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+size_t PatchStore::LowerBoundAddress(duint addr) const {
+  return std::lower_bound(m_address.begin(), m_address.end(), addr) -
+         m_address.begin();
+}
+
+size_t PatchStore::MemoryUsage() const {
+  return m_address.capacity() * sizeof(duint) +
+         m_head.capacity() * sizeof(duint) +
+         m_bytesOffset.capacity() * sizeof(uint32_t) +
+         m_byteCount.capacity() * sizeof(uint32_t) +
+         m_flags.capacity() * sizeof(uint8_t) +
+         (m_oldDisasm.capacity() + m_disasm.capacity() +
+          m_comment.capacity()) *
+             sizeof(uint32_t) +
+         m_module.capacity() * sizeof(ModuleId) +
+         m_moduleRuns.capacity() * sizeof(uint32_t) +
+         m_bytes.capacity() + m_strings.capacity();
+}
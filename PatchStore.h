@@ -0,0 +1,130 @@
+#pragma once
+#include "ModuleTable.h"
+#include "TrigramIndex.h"
+#include "pluginsdk/_plugin_types.h" // For duint
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// One patch group while it is being built (sync worker)
+struct PatchInfo {
+  duint address;
+  duint head; // Instruction start address
+  std::vector<unsigned char> oldBytes;
+  std::vector<unsigned char> newBytes;
+  std::string comment;   // User comment
+  std::string oldDisasm; // Disassembly BEFORE patch
+  std::string disasm;    // Disassembly AFTER patch
+  bool active;
+  ModuleId module; // Interned module name
+};
+
+// Index range [begin, end) of a store
+struct IndexRange {
+  size_t begin;
+  size_t end;
+};
+
+// Column store for patch groups. Per-group scalars live in parallel arrays,
+// old/new bytes share one byte arena and all text shares one NUL-separated
+// string arena, so a group costs a handful of fixed-size slots instead of
+// seven heap allocations. Groups are appended in address order and are
+// immutable afterwards; filtered lists are vectors of indices into a store.
+class PatchStore {
+public:
+  PatchStore();
+
+  size_t size() const { return m_address.size(); }
+  bool empty() const { return m_address.empty(); }
+  void clear();
+  void swap(PatchStore &other);
+
+  // Returns the index of the new group
+  size_t Append(const PatchInfo &p);
+  // Append every group of 'other' (arenas are copied in bulk)
+  void Append(const PatchStore &other);
+
+  duint Address(size_t i) const { return m_address[i]; }
+  duint Head(size_t i) const { return m_head[i]; }
+  size_t ByteCount(size_t i) const { return m_byteCount[i]; }
+  duint End(size_t i) const { return m_address[i] + m_byteCount[i]; }
+  const unsigned char *OldBytes(size_t i) const {
+    return m_bytes.data() + m_bytesOffset[i];
+  }
+  const unsigned char *NewBytes(size_t i) const {
+    return m_bytes.data() + m_bytesOffset[i] + m_byteCount[i];
+  }
+  // Old then new bytes of every group, back to back in index order
+  const unsigned char *ByteArena() const { return m_bytes.data(); }
+  size_t ByteArenaSize() const { return m_bytes.size(); }
+  size_t BytesOffset(size_t i) const { return m_bytesOffset[i]; }
+  const char *OldDisasm(size_t i) const { return Text(m_oldDisasm[i]); }
+  const char *Disasm(size_t i) const { return Text(m_disasm[i]); }
+  const char *Comment(size_t i) const { return Text(m_comment[i]); }
+  // Search shadows: the text columns case-folded with FoldAscii (comments
+  // with FoldAnsi), built once as groups are appended
+  const char *FoldedOldDisasm(size_t i) const { return Folded(m_oldDisasm[i]); }
+  const char *FoldedDisasm(size_t i) const { return Folded(m_disasm[i]); }
+  const char *FoldedComment(size_t i) const { return Folded(m_comment[i]); }
+  ModuleId Module(size_t i) const { return m_module[i]; }
+  const char *ModuleName(size_t i) const { return ModuleNameById(m_module[i]); }
+  bool Active(size_t i) const { return (m_flags[i] & FLAG_ACTIVE) != 0; }
+
+  // Copy of group i as a PatchInfo
+  PatchInfo Get(size_t i) const;
+
+  // Same address, module and old/new bytes
+  bool IsSameGroup(size_t i, const PatchInfo &p) const;
+
+  // Append the index ranges holding the groups of 'module', in order. A
+  // loaded module is one contiguous run of the address-sorted store, but
+  // MODULE_NONE groups (heap, unloaded code) are scattered between them.
+  void ModuleRanges(ModuleId module, std::vector<IndexRange> &ranges) const;
+
+  // First index whose group ends after 'addr' / starts at or after 'addr'
+  // (binary search; groups are sorted and don't overlap)
+  size_t LowerBoundEnd(duint addr) const;
+  size_t LowerBoundAddress(duint addr) const;
+
+  // Heap bytes held by the store, not counting the search shadows and the
+  // trigram index
+  size_t MemoryUsage() const;
+  size_t FoldedMemoryUsage() const { return m_folded.capacity(); }
+
+  // Trigrams of the text columns, kept up to date by Append
+  const TrigramIndex &Trigrams() const { return m_trigrams; }
+
+  // Changes whenever the contents change; unique across stores, so views
+  // and caches built from a store can tell when they are stale
+  uint32_t Generation() const { return m_generation; }
+
+private:
+  enum { FLAG_ACTIVE = 1 };
+
+  const char *Text(uint32_t offset) const { return m_strings.data() + offset; }
+  const char *Folded(uint32_t offset) const { return m_folded.data() + offset; }
+  uint32_t AddText(const std::string &text, bool ansi);
+  void Touch();
+  void AddModuleRun(size_t index, ModuleId module);
+
+  std::vector<duint> m_address;
+  std::vector<duint> m_head;
+  std::vector<uint32_t> m_bytesOffset; // Old bytes, then new bytes
+  std::vector<uint32_t> m_byteCount;
+  std::vector<uint8_t> m_flags;
+  std::vector<uint32_t> m_oldDisasm; // Offsets into m_strings
+  std::vector<uint32_t> m_disasm;
+  std::vector<uint32_t> m_comment;
+  std::vector<ModuleId> m_module;
+  std::vector<uint32_t> m_moduleRuns; // Index where each run of equal
+                                      // module IDs starts
+
+  std::vector<unsigned char> m_bytes; // Byte arena
+  std::vector<char> m_strings;        // String arena, offset 0 is ""
+  std::vector<char> m_folded;         // m_strings folded, same offsets
+  TrigramIndex m_trigrams;
+  uint32_t m_generation;
+};
+
+// Filtered list: indices into a PatchStore
+typedef std::vector<uint32_t> PatchView;
@@ -0,0 +1,754 @@
+#include "PatchSync.h"
+#include "HeadResolver.h"
+#include "MemCache.h"
+#include "PatchCache.h"
+#include "ThreadPool.h"
+#include "pluginmain.h"
+#include <algorithm>
+#include <atomic>
+#include <ctype.h>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Bytes read around each head; the decoders only need the first 16
+#define GATHER_SIZE 120
+
+// State for one group while it is being finalized. Gather/annotate phases
+// talk to the debugger and run serially on the sync worker; decode/format
+// phases are pure and run on the thread pool.
+struct GroupWork {
+  PatchInfo *patch;
+  unsigned char bytes[128]; // Current memory at head (gather)
+  duint targets[3];         // Operand targets of the NEW instruction (decode)
+  int targetCount;
+  bool isBranch;
+  bool found;                        // Comment resolved (annotate)
+  char comment[MAX_COMMENT_SIZE];
+};
+
+// Phase 1 (serial): memory for all groups, page-cached
+static void GatherBytes(std::vector<GroupWork> &work) {
+  for (auto &w : work) {
+    memset(w.bytes, 0, sizeof(w.bytes));
+    CachedMemRead(w.patch->head, w.bytes, GATHER_SIZE);
+  }
+}
+
+// Phase 2 (parallel): old/new disassembly and operand targets
+static void DecodeGroup(GroupWork &w) {
+  const DBGFUNCTIONS *funcs = DbgFunctions();
+  PatchInfo &p = *w.patch;
+  w.targetCount = 0;
+  w.isBranch = false;
+  if (!funcs || !funcs->DisasmFast)
+    return;
+
+  // Disassemble NEW (current memory)
+  BASIC_INSTRUCTION_INFO info;
+  memset(&info, 0, sizeof(info));
+  funcs->DisasmFast(w.bytes, p.head, &info);
+  p.disasm = info.instruction;
+
+  // Operand candidates in DbgDisasmAt argument order: memory, immediate,
+  // branch target
+  if (info.type & TYPE_MEMORY)
+    w.targets[w.targetCount++] = info.memory.value;
+  if (info.type & TYPE_VALUE)
+    w.targets[w.targetCount++] = info.value.value;
+  if (info.type & TYPE_ADDR)
+    w.targets[w.targetCount++] = info.addr;
+
+  // Do NOT try to read strings for Jump/Call targets (code addresses).
+  // info.instruction contains the full string "mnem op1, op2", so the first
+  // word tells us whether this is a branch.
+  w.isBranch = info.branch;
+  if (info.instruction[0] == 'j' || info.instruction[0] == 'J')
+    w.isBranch = true;
+  if (_strnicmp(info.instruction, "call", 4) == 0)
+    w.isBranch = true;
+  if (_strnicmp(info.instruction, "loop", 4) == 0)
+    w.isBranch = true;
+
+  // Disassemble OLD
+  unsigned char bytes[128];
+  memcpy(bytes, w.bytes, sizeof(bytes));
+  for (size_t k = 0; k < p.oldBytes.size(); ++k) {
+    size_t off = (size_t)(p.address + k - p.head);
+    if (off < GATHER_SIZE)
+      bytes[off] = p.oldBytes[k];
+  }
+  funcs->DisasmFast(bytes, p.head, &info);
+  p.oldDisasm = info.instruction;
+}
+
+// Phase 3 (serial): comment, label and string lookups
+static void AnnotateGroup(GroupWork &w) {
+  const PatchInfo &p = *w.patch;
+  char *comment = w.comment;
+  comment[0] = 0;
+  w.found = false;
+
+  // 1. Try Comment at HEAD (User or Auto if supported)
+  // Use DbgGetCommentAt checking for both user and potentially auto comments
+  if (DbgGetCommentAt(p.head, comment)) {
+    // If it starts with \1, it's auto. x64dbg conventions.
+    // We accept it either way.
+    w.found = true;
+    return;
+  }
+
+  // 2. Try Label at HEAD
+  if (DbgGetLabelAt(p.head, SEG_DEFAULT, comment)) {
+    w.found = true;
+    return;
+  }
+
+  // 3. Address Reference / Operand Analysis
+  for (int k = 0; k < w.targetCount; ++k) {
+    duint targetAddr = w.targets[k];
+    // Ignore small values (likely not pointers)
+    if (targetAddr < 0x1000)
+      continue;
+
+    char info[MAX_COMMENT_SIZE] = "";
+
+    // 3a. Try Label at Target
+    if (DbgGetLabelAt(targetAddr, SEG_DEFAULT, info)) {
+      snprintf(comment, MAX_COMMENT_SIZE, "0x%X: \"%s\"",
+               (unsigned int)targetAddr, info);
+      w.found = true;
+      return;
+    }
+
+    // 3b. Try String at Target
+    // If it is a branch, it points to code. Do NOT treat as string.
+    if (!w.isBranch && DbgGetStringAt(targetAddr, info)) {
+      // Truncate
+      if (strlen(info) > 60)
+        strcpy(info + 57, "...");
+      snprintf(comment, MAX_COMMENT_SIZE, "0x%X: \"%s\"",
+               (unsigned int)targetAddr, info);
+      w.found = true;
+      return;
+    }
+  }
+
+  // 4. Fallback: Check Patch Address itself
+  if (p.address != p.head) {
+    if (DbgGetCommentAt(p.address, comment))
+      w.found = true;
+    else if (DbgGetLabelAt(p.address, SEG_DEFAULT, comment))
+      w.found = true;
+  }
+}
+
+// Phase 4 (parallel): comment text conversion
+static void FormatGroup(GroupWork &w) {
+  if (!w.found)
+    return;
+  char *finalComment = w.comment;
+  if (finalComment[0] == '\1') {
+    finalComment++;
+  }
+  w.patch->comment = Utf8ToAnsi(finalComment);
+}
+
+// Resolve old/new disassembly and comment for a batch of groups whose heads
+// are already set
+static void FinalizeGroups(std::vector<GroupWork> &work) {
+  if (work.empty())
+    return;
+  GatherBytes(work);
+  ParallelFor(work.size(), 32, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      DecodeGroup(work[i]);
+  });
+  for (auto &w : work)
+    AnnotateGroup(w);
+  ParallelFor(work.size(), 64, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      FormatGroup(work[i]);
+  });
+}
+
+// One patched byte from PatchEnum without the MAX_MODULE_SIZE name array
+struct PatchByte {
+  duint addr;
+  ModuleId module;
+  unsigned char oldbyte;
+  unsigned char newbyte;
+};
+
+// Stable LSD radix sort on addr, one byte per pass. Passes where every key
+// has the same digit (the high bytes of user-mode addresses) are skipped.
+static void RadixSortByAddress(std::vector<PatchByte> &bytes) {
+  std::vector<PatchByte> tmp(bytes.size());
+  for (size_t shift = 0; shift < sizeof(duint) * 8; shift += 8) {
+    size_t count[256] = {0};
+    for (const auto &b : bytes)
+      count[(b.addr >> shift) & 0xFF]++;
+    if (count[(bytes[0].addr >> shift) & 0xFF] == bytes.size())
+      continue;
+    size_t pos = 0;
+    for (size_t d = 0; d < 256; ++d) {
+      size_t c = count[d];
+      count[d] = pos;
+      pos += c;
+    }
+    for (const auto &b : bytes)
+      tmp[count[(b.addr >> shift) & 0xFF]++] = b;
+    bytes.swap(tmp);
+  }
+}
+
+std::vector<PatchInfo>
+GroupPatches(const std::vector<DBGPATCHINFO> &dbgPatches) {
+  std::vector<PatchInfo> groups;
+  if (dbgPatches.empty())
+    return groups;
+
+  // Reduce to compact records first. PatchEnum repeats the module name for
+  // every byte; intern it only when it changes between consecutive entries.
+  std::vector<PatchByte> bytes(dbgPatches.size());
+  const char *lastName = NULL;
+  ModuleId lastId = MODULE_NONE;
+  bool sorted = true;
+  for (size_t i = 0; i < dbgPatches.size(); ++i) {
+    const DBGPATCHINFO &dp = dbgPatches[i];
+    if (!lastName || strcmp(dp.mod, lastName) != 0) {
+      lastName = dp.mod;
+      lastId = InternModule(lastName);
+    }
+    bytes[i] = {dp.addr, lastId, dp.oldbyte, dp.newbyte};
+    if (i > 0 && dp.addr < dbgPatches[i - 1].addr)
+      sorted = false;
+  }
+  // x64dbg usually returns the list in address order already
+  if (!sorted)
+    RadixSortByAddress(bytes);
+
+  PatchInfo current;
+  current.address = bytes[0].addr;
+  current.head = current.address;
+  current.module = bytes[0].module;
+  current.oldBytes.push_back(bytes[0].oldbyte);
+  current.newBytes.push_back(bytes[0].newbyte);
+  current.active = true;
+
+  for (size_t i = 1; i < bytes.size(); ++i) {
+    const auto &b = bytes[i];
+    if (b.module == current.module &&
+        b.addr == current.address + current.oldBytes.size()) {
+      current.oldBytes.push_back(b.oldbyte);
+      current.newBytes.push_back(b.newbyte);
+    } else {
+      groups.push_back(current);
+
+      current.address = b.addr;
+      current.head = b.addr;
+      current.module = b.module;
+      current.oldBytes.clear();
+      current.newBytes.clear();
+      current.oldBytes.push_back(b.oldbyte);
+      current.newBytes.push_back(b.newbyte);
+    }
+  }
+  groups.push_back(current);
+  return groups;
+}
+
+// Half-open address range [start, end)
+struct AddrRange {
+  duint start;
+  duint end;
+};
+
+static void AddChangedRange(std::vector<AddrRange> &ranges, duint address,
+                            duint head, size_t size) {
+  duint start = address;
+  if (head < start)
+    start = head;
+  ranges.push_back({start, address + size});
+}
+
+static void AddChangedRange(std::vector<AddrRange> &ranges,
+                            const PatchInfo &p) {
+  AddChangedRange(ranges, p.address, p.head, p.oldBytes.size());
+}
+
+static void AddChangedRange(std::vector<AddrRange> &ranges,
+                            const PatchStore &store, size_t i) {
+  AddChangedRange(ranges, store.Address(i), store.Head(i),
+                  store.ByteCount(i));
+}
+
+// True if [start, end) lies within MAX_INSTRUCTION_LENGTH of a changed range.
+// 'changed' must be sorted and non-overlapping.
+static bool IsNearChange(const std::vector<AddrRange> &changed, duint start,
+                         duint end) {
+  duint lo = start > MAX_INSTRUCTION_LENGTH ? start - MAX_INSTRUCTION_LENGTH : 0;
+  duint hi = end + MAX_INSTRUCTION_LENGTH;
+  auto it = std::upper_bound(
+      changed.begin(), changed.end(), lo,
+      [](duint value, const AddrRange &r) { return value < r.end; });
+  return it != changed.end() && it->start < hi;
+}
+
+// Original code hashed in front of a group for the disk cache key; the
+// resolver never looks further back than this for a local head
+#define CACHE_CONTEXT_BEFORE 64
+
+// Disk cache key for groups[index]: module, RVA and a FNV-1a hash of the
+// code around it twice, as it was (old bytes of every group in the window
+// put back) and as it is now (this group's and its neighbours' new bytes).
+// 'base' receives the module base. Fails for groups outside a module.
+static bool MakeCacheKey(const std::vector<PatchInfo> &groups, size_t index,
+                         PatchCacheKey &key, duint &base) {
+  const PatchInfo &p = groups[index];
+  const DBGFUNCTIONS *funcs = DbgFunctions();
+  if (p.module == MODULE_NONE || !funcs || !funcs->ModBaseFromAddr)
+    return false;
+  base = funcs->ModBaseFromAddr(p.address);
+  if (!base || base > p.address)
+    return false;
+
+  duint start = p.address > CACHE_CONTEXT_BEFORE
+                    ? p.address - CACHE_CONTEXT_BEFORE
+                    : 0;
+  duint end = p.address + p.oldBytes.size() + MAX_INSTRUCTION_LENGTH;
+  std::vector<unsigned char> current((size_t)(end - start));
+  CachedMemRead(start, current.data(), current.size());
+  std::vector<unsigned char> code(current);
+
+  // Groups are sorted and disjoint: walk outwards from 'index'
+  auto overlay = [&](const PatchInfo &g) {
+    for (size_t k = 0; k < g.oldBytes.size(); ++k) {
+      duint addr = g.address + k;
+      if (addr >= start && addr < end)
+        code[(size_t)(addr - start)] = g.oldBytes[k];
+    }
+  };
+  for (size_t k = index + 1; k-- > 0;) {
+    if (groups[k].address + groups[k].oldBytes.size() <= start)
+      break;
+    overlay(groups[k]);
+  }
+  for (size_t k = index + 1; k < groups.size() && groups[k].address < end;
+       ++k)
+    overlay(groups[k]);
+
+  uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&](const unsigned char *data, size_t size) {
+    for (size_t k = 0; k < size; ++k) {
+      hash ^= data[k];
+      hash *= 1099511628211ULL;
+    }
+  };
+  mix(code.data(), code.size());
+  mix(current.data(), current.size());
+
+  key.module = ModuleNameById(p.module);
+  for (auto &c : key.module)
+    c = (char)tolower((unsigned char)c);
+  key.rva = p.address - base;
+  key.hash = hash;
+  return true;
+}
+
+// Cached text must not depend on the module base. Every 0x-prefixed hex
+// number that points into the group's module is stored as a marker holding
+// its RVA (MARK, flags, width, RVA in hex, END) and printed again with the
+// current base on a hit. Comments print operand addresses with "0x%X", so
+// there a number may also be the low 32 bits of a module address. Numbers
+// pointing anywhere else are kept as they are.
+#define CACHE_TEXT_MARK '\1'
+#define CACHE_TEXT_END '\2'
+#define CACHE_TEXT_LOWER 1     // Hex digits were lower case
+#define CACHE_TEXT_TRUNCATED 2 // Only the low 32 bits were printed
+
+static bool IsWordChar(char c) { return isalnum((unsigned char)c) || c == '_'; }
+
+// False if 'text' can't be stored (it holds a marker character itself)
+static bool PackCacheText(const std::string &text, duint base, bool comment,
+                          std::string &out) {
+  const DBGFUNCTIONS *funcs = DbgFunctions();
+  out.clear();
+  if (!funcs || !funcs->ModBaseFromAddr ||
+      text.find(CACHE_TEXT_MARK) != std::string::npos)
+    return false;
+
+  size_t i = 0;
+  while (i < text.size()) {
+    bool number = text[i] == '0' && i + 2 < text.size() &&
+                  (text[i + 1] == 'x' || text[i + 1] == 'X') &&
+                  isxdigit((unsigned char)text[i + 2]) &&
+                  (i == 0 || !IsWordChar(text[i - 1]));
+    if (!number) {
+      out.push_back(text[i++]);
+      continue;
+    }
+    size_t digits = i + 2, end = digits;
+    while (end < text.size() && isxdigit((unsigned char)text[end]))
+      ++end;
+    out.append(text, i, digits - i); // "0x" stays
+    i = end;
+
+    size_t count = end - digits;
+    bool wordEnd = end == text.size() || !IsWordChar(text[end]);
+    if (!wordEnd || count > sizeof(duint) * 2) {
+      out.append(text, digits, count);
+      continue;
+    }
+    duint value = 0;
+    int flags = 0;
+    for (size_t k = digits; k < end; ++k) {
+      char c = text[k];
+      value = value * 16 + (duint)(isdigit((unsigned char)c)
+                                       ? c - '0'
+                                       : tolower((unsigned char)c) - 'a' + 10);
+      if (islower((unsigned char)c))
+        flags |= CACHE_TEXT_LOWER;
+    }
+    duint addr = value;
+    if (funcs->ModBaseFromAddr(addr) != base && comment && count <= 8) {
+      addr = (base & ~(duint)0xFFFFFFFF) | value;
+      flags |= CACHE_TEXT_TRUNCATED;
+    }
+    if (funcs->ModBaseFromAddr(addr) != base) {
+      out.append(text, digits, count);
+      continue;
+    }
+    int width = text[digits] == '0' && count > 1 ? (int)count : 0;
+    char mark[32];
+    snprintf(mark, sizeof(mark), "%c%c%c%llX%c", CACHE_TEXT_MARK, 'a' + flags,
+             'a' + width, (unsigned long long)(addr - base), CACHE_TEXT_END);
+    out += mark;
+  }
+  return true;
+}
+
+static std::string UnpackCacheText(const std::string &text, duint base) {
+  std::string out;
+  size_t i = 0;
+  while (i < text.size()) {
+    size_t end = text[i] == CACHE_TEXT_MARK
+                     ? text.find(CACHE_TEXT_END, i)
+                     : std::string::npos;
+    if (end == std::string::npos || end < i + 4) {
+      out.push_back(text[i++]);
+      continue;
+    }
+    int flags = text[i + 1] - 'a';
+    int width = text[i + 2] - 'a';
+    duint value = base + (duint)strtoull(text.c_str() + i + 3, NULL, 16);
+    if (flags & CACHE_TEXT_TRUNCATED)
+      value &= 0xFFFFFFFF;
+    char number[40];
+    snprintf(number, sizeof(number),
+             flags & CACHE_TEXT_LOWER ? "%0*llx" : "%0*llX", width,
+             (unsigned long long)value);
+    out += number;
+    i = end + 1;
+  }
+  return out;
+}
+
+// Where a group's head comes from this sync. Reused and cached groups also
+// come with their disassembly and comment; the others are finalized.
+enum GroupSource { GROUP_RESOLVE, GROUP_REUSED, GROUP_CACHED };
+
+// Groups resolved, finalized and published per step while the sync runs
+#define SYNC_CHUNK_SIZE 512
+
+// Head lookups put back the old bytes of groups up to this far before the
+// group they work on (the resolver's function anchor; cache keys need less)
+#define SYNC_LOOKBEHIND MAX_FUNCTION_DISTANCE
+
+struct SyncJob {
+  HWND notifyWnd;
+  bool fullRebuild;
+  PatchStore prev; // Last complete list, read only by the worker
+  std::atomic<bool> cancel{false};
+  std::atomic<bool> notified{false};
+  std::thread thread;
+
+  // Guarded by lock
+  std::mutex lock;
+  PatchStore ready;
+  SyncState state = SYNC_RUNNING;
+  size_t done = 0;
+  size_t total = 0;
+};
+
+static SyncJob *g_SyncJob = NULL; // Owned by the GUI thread
+
+static void PublishSync(SyncJob *job, PatchStore &batch, size_t done,
+                        SyncState state) {
+  {
+    std::lock_guard<std::mutex> guard(job->lock);
+    if (job->ready.empty())
+      job->ready.swap(batch);
+    else
+      job->ready.Append(batch);
+    job->done = done;
+    job->state = state;
+  }
+  batch.clear();
+  // One pending notification is enough, the GUI drains everything at once
+  if (!job->notified.exchange(true))
+    PostMessage(job->notifyWnd, WM_PATCH_SYNC, 0, 0);
+}
+
+static void SyncWorker(SyncJob *job) {
+  PatchStore batch;
+  const DBGFUNCTIONS *funcs = DbgFunctions();
+  if (!funcs || !funcs->PatchEnum) {
+    PublishSync(job, batch, 0, SYNC_FAILED);
+    return;
+  }
+
+  size_t size = 0;
+  if (!funcs->PatchEnum(NULL, &size) || size == 0) {
+    PublishSync(job, batch, 0, SYNC_DONE);
+    return;
+  }
+
+  std::vector<DBGPATCHINFO> dbgPatches(size / sizeof(DBGPATCHINFO));
+  if (!funcs->PatchEnum(dbgPatches.data(), &size)) {
+    PublishSync(job, batch, 0, SYNC_FAILED);
+    return;
+  }
+
+  std::vector<PatchInfo> groups = GroupPatches(dbgPatches);
+  const PatchStore &prev = job->prev;
+  {
+    std::lock_guard<std::mutex> guard(job->lock);
+    job->total = groups.size();
+  }
+
+  // Diff against the previous sync. Both lists are sorted by address, so one
+  // merge pass finds added, removed and modified groups.
+  const size_t npos = (size_t)-1;
+  std::vector<size_t> reuseFrom(groups.size(), npos);
+  std::vector<AddrRange> changed;
+  if (!job->fullRebuild) {
+    size_t i = 0, j = 0;
+    while (i < prev.size() || j < groups.size()) {
+      if (j == groups.size() ||
+          (i < prev.size() && prev.Address(i) < groups[j].address)) {
+        AddChangedRange(changed, prev, i++); // Removed
+      } else if (i == prev.size() || groups[j].address < prev.Address(i)) {
+        AddChangedRange(changed, groups[j++]); // Added
+      } else {
+        if (prev.IsSameGroup(i, groups[j])) {
+          reuseFrom[j] = i;
+        } else {
+          AddChangedRange(changed, prev, i); // Modified
+          AddChangedRange(changed, groups[j]);
+        }
+        ++i;
+        ++j;
+      }
+    }
+
+    // Coalesce into sorted, disjoint ranges for the neighbourhood check
+    std::sort(changed.begin(), changed.end(),
+              [](const AddrRange &a, const AddrRange &b) {
+                return a.start < b.start;
+              });
+    size_t n = 0;
+    for (size_t k = 0; k < changed.size(); ++k) {
+      if (n > 0 && changed[k].start <= changed[n - 1].end) {
+        if (changed[k].end > changed[n - 1].end)
+          changed[n - 1].end = changed[k].end;
+      } else {
+        changed[n++] = changed[k];
+      }
+    }
+    changed.resize(n);
+  }
+
+  // Decide up front what can be reused; everything else is resolved block by
+  // block below
+  std::vector<char> source(groups.size(), GROUP_RESOLVE);
+  size_t reused = 0;
+  for (size_t j = 0; j < groups.size(); ++j) {
+    if (reuseFrom[j] == npos)
+      continue;
+    duint oldHead = prev.Head(reuseFrom[j]);
+    duint start = oldHead < groups[j].address ? oldHead : groups[j].address;
+    if (!IsNearChange(changed, start,
+                      groups[j].address + groups[j].oldBytes.size())) {
+      source[j] = GROUP_REUSED;
+      ++reused;
+    }
+  }
+
+  // Resolve, finalize and publish block by block so the list fills while we
+  // work. Builder records are released once the next block's lookups can no
+  // longer reach back to their old bytes.
+  std::vector<PatchCacheKey> keys(SYNC_CHUNK_SIZE);
+  std::vector<char> hasKey(SYNC_CHUNK_SIZE);
+  std::vector<duint> bases(SYNC_CHUNK_SIZE);
+  size_t cached = 0, released = 0;
+  HeadResolver resolver(prev);
+  std::vector<GroupWork> work;
+  for (size_t begin = 0; begin < groups.size(); begin += SYNC_CHUNK_SIZE) {
+    size_t end = begin + SYNC_CHUNK_SIZE;
+    if (end > groups.size())
+      end = groups.size();
+
+    // Groups not reused: try the disk cache, then resolve. A full rebuild
+    // skips the lookups but still rewrites the entries.
+    for (size_t j = begin; j < end; ++j) {
+      if (job->cancel)
+        return;
+      PatchInfo &p = groups[j];
+      PatchCacheKey &key = keys[j - begin];
+      char &has = hasKey[j - begin];
+      has = 0;
+      if (source[j] == GROUP_REUSED) {
+        p.head = prev.Head(reuseFrom[j]);
+        continue;
+      }
+      duint &base = bases[j - begin];
+      has = MakeCacheKey(groups, j, key, base);
+      PatchCacheEntry entry;
+      if (has && !job->fullRebuild && PatchCacheLookup(key, entry)) {
+        p.head = p.address + entry.headDelta;
+        p.oldDisasm = UnpackCacheText(entry.oldDisasm, base);
+        p.disasm = UnpackCacheText(entry.disasm, base);
+        p.comment = UnpackCacheText(entry.comment, base);
+        source[j] = GROUP_CACHED;
+        ++cached;
+        continue;
+      }
+      p.head = resolver.Resolve(groups, j);
+    }
+
+    work.clear();
+    for (size_t j = begin; j < end; ++j) {
+      PatchInfo &p = groups[j];
+      if (source[j] == GROUP_REUSED) {
+        size_t old = reuseFrom[j];
+        p.oldDisasm = prev.OldDisasm(old);
+        p.disasm = prev.Disasm(old);
+        p.comment = prev.Comment(old);
+        p.active = prev.Active(old);
+      } else if (source[j] == GROUP_RESOLVE) {
+        work.emplace_back();
+        work.back().patch = &p;
+      }
+    }
+    FinalizeGroups(work);
+
+    for (size_t j = begin; j < end; ++j) {
+      if (source[j] != GROUP_RESOLVE || !hasKey[j - begin])
+        continue;
+      const PatchInfo &p = groups[j];
+      duint base = bases[j - begin];
+      PatchCacheEntry entry;
+      entry.headDelta = (int32_t)(p.head - p.address);
+      if (PackCacheText(p.oldDisasm, base, false, entry.oldDisasm) &&
+          PackCacheText(p.disasm, base, false, entry.disasm) &&
+          PackCacheText(p.comment, base, true, entry.comment))
+        PatchCacheStore(keys[j - begin], entry);
+    }
+
+    for (size_t j = begin; j < end; ++j)
+      batch.Append(groups[j]);
+    if (end == groups.size())
+      break;
+
+    // Release the builder's heap blocks early
+    duint reach = groups[end].address > SYNC_LOOKBEHIND
+                      ? groups[end].address - SYNC_LOOKBEHIND
+                      : 0;
+    for (; released < end; ++released) {
+      const PatchInfo &p = groups[released];
+      if (p.address + p.oldBytes.size() > reach)
+        break;
+      groups[released] = PatchInfo();
+    }
+    PublishSync(job, batch, end, SYNC_RUNNING);
+  }
+
+  const HeadResolver::Stats &heads = resolver.GetStats();
+  Log("[PatchMgr] Sync: %d groups, %d reused, %d from cache, %d resolved "
+      "(heads: %d local, %d trace, %d debugger)\n",
+      (int)groups.size(), (int)reused, (int)cached,
+      (int)(groups.size() - reused - cached), (int)heads.local,
+      (int)heads.traced, (int)heads.debugger);
+  PublishSync(job, batch, groups.size(), SYNC_DONE);
+}
+
+// Cancel and join the current job. A job that finished successfully hands
+// over whatever the GUI has not collected yet; otherwise 'all' goes back to
+// the last complete list.
+static void StopSyncJob(PatchStore &all) {
+  SyncJob *job = g_SyncJob;
+  if (!job)
+    return;
+  g_SyncJob = NULL;
+
+  job->cancel = true;
+  if (job->thread.joinable())
+    job->thread.join();
+
+  if (job->state == SYNC_DONE) {
+    all.Append(job->ready);
+  } else {
+    all.swap(job->prev);
+  }
+  delete job;
+}
+
+void StartPatchSync(HWND notifyWnd, bool fullRebuild, PatchStore &all) {
+  StopSyncJob(all);
+  InvalidateMemCache(); // Patches may have been made outside the plugin
+
+  SyncJob *job = new SyncJob;
+  job->notifyWnd = notifyWnd;
+  job->fullRebuild = fullRebuild;
+  job->prev.swap(all);
+  all.clear();
+  g_SyncJob = job;
+  job->thread = std::thread(SyncWorker, job);
+}
+
+SyncProgress CollectPatchSync(PatchStore &all) {
+  SyncProgress progress = {SYNC_IDLE, 0, 0};
+  SyncJob *job = g_SyncJob;
+  if (!job)
+    return progress;
+
+  PatchStore ready;
+  {
+    std::lock_guard<std::mutex> guard(job->lock);
+    job->notified = false;
+    ready.swap(job->ready);
+    progress.state = job->state;
+    progress.done = job->done;
+    progress.total = job->total;
+  }
+  all.Append(ready);
+
+  if (progress.state != SYNC_RUNNING) {
+    // Worker has published its last batch and is exiting
+    if (job->thread.joinable())
+      job->thread.join();
+    if (progress.state == SYNC_FAILED)
+      all.swap(job->prev);
+    g_SyncJob = NULL;
+    delete job;
+  }
+  return progress;
+}
+
+void CancelPatchSync(PatchStore &all) { StopSyncJob(all); }
+
+bool IsPatchSyncRunning() { return g_SyncJob != NULL; }
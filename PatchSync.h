@@ -0,0 +1,37 @@
+#pragma once
+#include "PatchWindow.h"
+#include <windows.h>
+
+// Posted to the notify window whenever the sync worker has new groups ready
+#define WM_PATCH_SYNC (WM_APP + 1)
+
+enum SyncState { SYNC_IDLE, SYNC_RUNNING, SYNC_DONE, SYNC_FAILED };
+
+struct SyncProgress {
+  SyncState state;
+  size_t done;  // Groups finished so far
+  size_t total; // Groups in this sync (0 until enumeration is done)
+};
+
+// Rebuild 'all' from the debugger's patch list on a worker thread.
+// The current contents of 'all' are handed to the worker as the previous
+// snapshot and 'all' is emptied; finished groups are then handed back in
+// address order through CollectPatchSync. Groups whose bytes did not change
+// keep their resolved head, disassembly and comment unless fullRebuild is
+// set. A sync that is still running is cancelled first.
+void StartPatchSync(HWND notifyWnd, bool fullRebuild, PatchStore &all);
+
+// Append groups finished since the last call to 'all'. Call on
+// WM_PATCH_SYNC. On SYNC_FAILED 'all' is reset to the previous snapshot.
+SyncProgress CollectPatchSync(PatchStore &all);
+
+// Stop a running sync and wait for the worker. If it had not finished,
+// 'all' is reset to the previous snapshot.
+void CancelPatchSync(PatchStore &all);
+
+bool IsPatchSyncRunning();
+
+// Sort PatchEnum's byte list and merge contiguous bytes of the same module
+// into groups. Only address, module and bytes are filled in.
+std::vector<PatchInfo>
+GroupPatches(const std::vector<DBGPATCHINFO> &dbgPatches);
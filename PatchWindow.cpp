@@ -1,14 +1,20 @@
 #include "PatchWindow.h"
+#include "Breakpoints.h"
+#include "MemCache.h"
+#include "PatchCache.h"
+#include "PatchFilter.h"
+#include "PatchRows.h"
+#include "PatchState.h"
+#include "PatchWriter.h"
+#include "PatchSync.h"
 #include "icon_data.h" // For Window Icon
 #include "pluginmain.h"
 #include "pluginsdk/_scriptapi_module.h"
 #include <algorithm>
+#include <atomic>
 #include <commctrl.h>
-#include <iomanip>
-
-#include <regex>
-#include <sstream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 #include <windows.h>
 #pragma comment(lib, "comctl32.lib")
@@ -29,9 +35,11 @@
 #define ID_MENU_SAVE 2009
 #define ID_MENU_REMOVE_ALL_IN_LIST 2010
 #define ID_MENU_TOGGLE_BPS_ALL 2011
+#define ID_MENU_FULL_REFRESH 2012
+#define ID_MENU_REMOVE_MODULE 2013
 
-std::vector<PatchInfo> g_Patches;    // THE DISPLAYED LIST (Filtered)
-std::vector<PatchInfo> g_AllPatches; // THE FULL LIST (Source of truth)
+PatchView g_Patches;     // THE DISPLAYED LIST (Filtered indices)
+PatchStore g_AllPatches; // THE FULL LIST (Source of truth)
 
 HWND hPatchWindow = NULL;
 HWND hList = NULL;
@@ -40,40 +48,43 @@ HWND hFilterEditOld = NULL;
 HWND hFilterEditNew = NULL;
 HWND hChkInverseOld = NULL;
 HWND hChkInverseNew = NULL;
+HWND hSyncProgress = NULL;
+HWND hBtnCancelSync = NULL;
 #define ID_CHK_INVERSE_OLD 1005
 #define ID_CHK_INVERSE_NEW 1006
+#define IDC_SYNC_PROGRESS 1007
+#define IDC_BTN_CANCEL_SYNC 1008
+
+// Posted by RequestAutoRefresh (any thread)
+#define WM_PATCH_AUTOREFRESH (WM_APP + 2)
+#define IDT_AUTOREFRESH 1
+
+// Selected groups by address, their identity (like g_HiddenPatches), so a
+// selection survives filter changes and refreshes that move its rows
+struct ListSelection {
+  std::vector<duint> addresses; // Sorted
+  duint focus = 0;
+  int focusRow = -1; // Used when none of the groups is listed anymore
+};
+
+ListSelection g_SyncSelection; // Selection to restore once a refresh completes
+ListSelection g_KeptSelection; // Taken by SetPatchView for UpdateListView
+bool g_SelectionKept = false;
+
+// Formatted rows kept for LVN_GETDISPINFO; a few screens' worth
+#define ROW_CACHE_SIZE 256
+PatchRowCache g_RowCache(ROW_CACHE_SIZE);
+PatchStateCache g_StateCache; // Row colours, per memory cache epoch
 
 WNDPROC oldListWndProc = NULL;
 HFONT g_hBoldFont = NULL;
 
 // Forward Declarations
-void RefreshPatchList();
 void ApplyFilter();
-bool ApplyPatch(const PatchInfo &patch);
-bool RestorePatch(const PatchInfo &patch);
+void UpdateListView();
+void LayoutPatchWindow(HWND hwnd);
 void ShowContextMenu(HWND hwnd, POINT pt);
 
-// Helper: Check if memory matches bytes
-bool IsMemoryMatching(duint addr, const std::vector<unsigned char> &bytes) {
-  if (bytes.empty())
-    return false;
-  std::vector<unsigned char> mem(bytes.size());
-  if (!DbgMemRead(addr, mem.data(), bytes.size()))
-    return false;
-  return mem == bytes;
-}
-
-std::string BytesToHex(const std::vector<unsigned char> &bytes) {
-  std::stringstream ss;
-  ss << std::hex << std::setfill('0');
-  for (size_t i = 0; i < bytes.size(); ++i) {
-    if (i > 0)
-      ss << " ";
-    ss << std::setw(2) << (int)bytes[i];
-  }
-  return ss.str();
-}
-
 void Log(const char *format, ...) {
   char buffer[1024];
   va_list args;
@@ -106,344 +117,264 @@ std::string Utf8ToAnsi(const std::string &utf8) {
   return std::string(aBuf.data());
 }
 
-// Finalized Solution: Official SDK Demands (OSD)
-duint FindCorrectOldHead(duint patchAddr,
-                         const std::vector<unsigned char> &oldBytes) {
-  const DBGFUNCTIONS *funcs = DbgFunctions();
-  if (!funcs)
-    return patchAddr;
-
-  // Strategy 1: Source Info
-  char sourceFile[MAX_PATH] = {0};
-  int line = 0;
-  if (funcs->GetSourceFromAddr &&
-      funcs->GetSourceFromAddr(patchAddr, sourceFile, &line)) {
-    duint displacement = 0;
-    duint addr = funcs->GetAddrFromLine(sourceFile, line, &displacement);
-    if (addr != 0 && addr <= patchAddr) {
-      return addr;
-    }
-  }
+// Compile the current contents of the filter boxes. Returns false if the
+// filter is empty or invalid (everything matches).
+bool LoadFilter(PatchFilter &filter) {
+  char filterBufOld[256] = {0};
+  char filterBufNew[256] = {0};
 
-  // Strategy 2: DbgEval Expression
-  char expr[128];
-  bool success = false;
-  _set_errno(0);
-#ifdef _WIN64
-  sprintf(expr, "dis.prev(0x%llX + 1)", (unsigned long long)patchAddr);
-#else
-  sprintf(expr, "dis.prev(0x%X + 1)", (unsigned int)patchAddr);
-#endif
-
-  duint head = DbgEval(expr, &success);
-  if (success && head != 0 && head <= patchAddr) {
-#ifdef _WIN64
-    sprintf(expr, "dis.len(0x%llX)", (unsigned long long)head);
-#else
-    sprintf(expr, "dis.len(0x%X)", (unsigned int)head);
-#endif
-    duint len = DbgEval(expr, &success);
-    if (success && patchAddr < head + len) {
-      return head;
-    }
-  }
+  if (hFilterEditOld)
+    GetWindowText(hFilterEditOld, filterBufOld, 255);
+  if (hFilterEditNew)
+    GetWindowText(hFilterEditNew, filterBufNew, 255);
 
-  // Strategy 3: Trace Record
-  for (int off = 0; off <= 15; ++off) {
-    if (patchAddr < (duint)off)
-      break;
-    duint test = patchAddr - off;
-    if (funcs->GetTraceRecordByteType &&
-        funcs->GetTraceRecordByteType(test) == 1) {
-      return test;
-    }
-  }
+  bool invOld = (hChkInverseOld && SendMessage(hChkInverseOld, BM_GETCHECK, 0,
+                                               0) == BST_CHECKED);
+  bool invNew = (hChkInverseNew && SendMessage(hChkInverseNew, BM_GETCHECK, 0,
+                                               0) == BST_CHECKED);
 
-  return patchAddr;
+  return filter.Compile(filterBufOld, invOld, filterBufNew, invNew);
 }
 
-// Sync from debugger to g_AllPatches
-void SyncPatchesFromDebugger() {
-  const DBGFUNCTIONS *funcs = DbgFunctions();
-  if (!funcs || !funcs->PatchEnum) {
-    return;
-  }
+// Rows hidden with Del, by group address so they stay hidden across filter
+// changes and refreshes. Cleared by a full refresh.
+std::unordered_set<duint> g_HiddenPatches;
 
-  size_t size = 0;
-  if (!funcs->PatchEnum(NULL, &size) || size == 0) {
-    g_AllPatches.clear();
-    return;
-  }
+bool IsHiddenPatch(size_t index) {
+  return !g_HiddenPatches.empty() &&
+         g_HiddenPatches.count(g_AllPatches.Address(index)) != 0;
+}
 
-  std::vector<DBGPATCHINFO> dbgPatches(size / sizeof(DBGPATCHINFO));
-  if (!funcs->PatchEnum(dbgPatches.data(), &size)) {
-    return;
+// Cached filter results ignore hidden rows, so hiding never invalidates them
+void RemoveHiddenRows(PatchView &view) {
+  if (!g_HiddenPatches.empty()) {
+    view.erase(std::remove_if(view.begin(), view.end(), IsHiddenPatch),
+               view.end());
   }
+}
 
-  g_AllPatches.clear();
-
-  // Sort
-  std::sort(dbgPatches.begin(), dbgPatches.end(),
-            [](const DBGPATCHINFO &a, const DBGPATCHINFO &b) {
-              return a.addr < b.addr;
-            });
+bool g_FilterPassPending = false; // g_Patches is behind the filter boxes
 
-  if (dbgPatches.empty())
+// Rows of g_Patches selected in the list, ascending
+void GetSelectedRows(std::vector<int> &rows) {
+  rows.clear();
+  if (!hList)
     return;
+  rows.reserve(ListView_GetSelectedCount(hList));
+  for (int i = ListView_GetNextItem(hList, -1, LVNI_SELECTED); i != -1;
+       i = ListView_GetNextItem(hList, i, LVNI_SELECTED))
+    rows.push_back(i);
+}
 
-  // Group
-  PatchInfo current;
-  current.address = dbgPatches[0].addr;
-  current.moduleName = dbgPatches[0].mod;
-  current.oldBytes.push_back(dbgPatches[0].oldbyte);
-  current.newBytes.push_back(dbgPatches[0].newbyte);
-  current.active = true;
-
-  auto finalizeGroup = [&](PatchInfo &p) {
-    p.head = FindCorrectOldHead(p.address, p.oldBytes);
-    BASIC_INSTRUCTION_INFO bInfo;
-    DISASM_INSTR dInstr;
-
-    // Disassemble NEW
-    DbgDisasmAt(p.head, &dInstr);
-    p.disasm = dInstr.instruction;
-
-    // Disassemble OLD
-    unsigned char bytes[128] = {0};
-    DbgMemRead(p.head, bytes, 120);
-    for (size_t k = 0; k < p.oldBytes.size(); ++k) {
-      size_t off = (size_t)(p.address + k - p.head);
-      if (off < 120)
-        bytes[off] = p.oldBytes[k];
-    }
-    if (funcs && funcs->DisasmFast) {
-      funcs->DisasmFast(bytes, p.head, &bInfo);
-      p.oldDisasm = bInfo.instruction;
-    }
-    char comment[MAX_COMMENT_SIZE] = "";
-    bool found = false;
-
-    // 1. Try Comment at HEAD (User or Auto if supported)
-    // Use DbgGetCommentAt checking for both user and potentially auto comments
-    if (DbgGetCommentAt(p.head, comment)) {
-      // If it starts with \1, it's auto. x64dbg conventions.
-      // We accept it either way.
-      found = true;
-    }
-
-    // 2. Try Label at HEAD
-    if (!found) {
-      if (DbgGetLabelAt(p.head, SEG_DEFAULT, comment)) {
-        found = true;
-      }
-    }
-
-    // 3. Address Reference / Operand Analysis
-    if (!found) {
-      for (int k = 0; k < dInstr.argcount; ++k) {
-        duint targetAddr = dInstr.arg[k].value;
-        // Ignore small values (likely not pointers)
-        if (targetAddr < 0x1000)
-          continue;
-
-        char info[MAX_COMMENT_SIZE] = "";
-
-        // 3a. Try Label at Target
-        if (DbgGetLabelAt(targetAddr, SEG_DEFAULT, info)) {
-          snprintf(comment, MAX_COMMENT_SIZE, "0x%X: \"%s\"",
-                   (unsigned int)targetAddr, info);
-          found = true;
-          break;
-        }
-
-        // 3b. Try String at Target
-        // CRITICAL FIX: Do NOT try to read strings for Jump/Call targets (Code
-        // addresses). Only try string resolution if mnemonic suggests data
-        // access (push, mov, lea, etc.) Simple filter: If mnemonic starts with
-        // 'j', 'c' (call), 'l' (loop), skip string check. Better: Explicitly
-        // check for 'j', 'call', 'loop'.
-        char mne[64];
-        strncpy(mne, dInstr.instruction, 63); // "push eax" or "ja 0x..."?
-        // Wait, dInstr.instruction is part of disassembly text?
-        // No, definitions say: char mnemonic[64]; in DISASM_ARG?
-        // Check DISASM_INSTR again.
-        // In bridgemain.h:
-        // typedef struct { ... char instruction[64]; DISASM_ARGTYPE type; ... }
-        // DISASM_INSTR; Actually usually the structure has a 'mnemonic' field
-        // separate or part of instruction text. But we can parse
-        // dInstr.instruction (e.g. "push 0x401000") or just rely on manual
-        // check.
-
-        // NOTE: dInstr.instruction contains the full string "mnem op1, op2".
-        // We need to check the first word.
-        bool isBranch = false;
-        if (dInstr.instruction[0] == 'j' || dInstr.instruction[0] == 'J')
-          isBranch = true;
-        if (_strnicmp(dInstr.instruction, "call", 4) == 0)
-          isBranch = true;
-        if (_strnicmp(dInstr.instruction, "loop", 4) == 0)
-          isBranch = true;
-
-        // If it is a branch, it points to code. Do NOT treat as string.
-        if (!isBranch && DbgGetStringAt(targetAddr, info)) {
-          // Truncate
-          if (strlen(info) > 60)
-            strcpy(info + 57, "...");
-          snprintf(comment, MAX_COMMENT_SIZE, "0x%X: \"%s\"",
-                   (unsigned int)targetAddr, info);
-          found = true;
-          break;
-        }
-      }
-    }
+// Row that single-row actions (follow, module) use: the focused row if it
+// is selected, otherwise the first selected one
+int GetFocusRow() {
+  int focus = ListView_GetNextItem(hList, -1, LVNI_FOCUSED);
+  if (focus != -1 &&
+      (ListView_GetItemState(hList, focus, LVIS_SELECTED) & LVIS_SELECTED))
+    return focus;
+  return ListView_GetNextItem(hList, -1, LVNI_SELECTED);
+}
 
-    // 4. Fallback: Check Patch Address itself
-    if (!found && p.address != p.head) {
-      if (DbgGetCommentAt(p.address, comment))
-        found = true;
-      else if (DbgGetLabelAt(p.address, SEG_DEFAULT, comment))
-        found = true;
-    }
+// Only valid while the list still shows g_Patches of g_AllPatches
+void SaveSelection(ListSelection &selection) {
+  std::vector<int> rows;
+  GetSelectedRows(rows);
+  selection.addresses.clear();
+  for (int row : rows) {
+    if (row < (int)g_Patches.size() && g_Patches[row] < g_AllPatches.size())
+      selection.addresses.push_back(g_AllPatches.Address(g_Patches[row]));
+  }
+  // g_Patches is in address order, so the addresses are sorted already
+  selection.focusRow = rows.empty() ? -1 : GetFocusRow();
+  if (selection.focusRow >= 0 && selection.focusRow < (int)g_Patches.size() &&
+      g_Patches[selection.focusRow] < g_AllPatches.size())
+    selection.focus = g_AllPatches.Address(g_Patches[selection.focusRow]);
+}
 
-    if (found) {
-      char *finalComment = comment;
-      if (finalComment[0] == '\1') {
-        finalComment++;
-      }
-      p.comment = Utf8ToAnsi(finalComment);
-    }
-  };
+// Row showing the group at 'addr', or -1
+int FindListRow(duint addr) {
+  auto it = std::lower_bound(g_Patches.begin(), g_Patches.end(), addr,
+                             [](uint32_t index, duint a) {
+                               return g_AllPatches.Address(index) < a;
+                             });
+  if (it == g_Patches.end() || g_AllPatches.Address(*it) != addr)
+    return -1;
+  return (int)(it - g_Patches.begin());
+}
 
-  for (size_t i = 1; i < dbgPatches.size(); ++i) {
-    const auto &dp = dbgPatches[i];
-    if (strcmp(dp.mod, current.moduleName.c_str()) == 0 &&
-        dp.addr == current.address + current.oldBytes.size()) {
-      current.oldBytes.push_back(dp.oldbyte);
-      current.newBytes.push_back(dp.newbyte);
-    } else {
-      finalizeGroup(current);
-      g_AllPatches.push_back(current);
-
-      current.address = dp.addr;
-      current.moduleName = dp.mod;
-      current.oldBytes.clear();
-      current.newBytes.clear();
-      current.oldBytes.push_back(dp.oldbyte);
-      current.newBytes.push_back(dp.newbyte);
-      current.oldDisasm.clear();
-      current.disasm.clear();
-      current.comment.clear();
-    }
+void RestoreSelection(const ListSelection &selection) {
+  if (!hList)
+    return;
+  ListView_SetItemState(hList, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+  int focus = -1;
+  for (duint addr : selection.addresses) {
+    int row = FindListRow(addr);
+    if (row == -1)
+      continue;
+    ListView_SetItemState(hList, row, LVIS_SELECTED, LVIS_SELECTED);
+    if (focus == -1 || addr == selection.focus)
+      focus = row;
   }
-
-  if (!dbgPatches.empty()) {
-    finalizeGroup(current);
-    g_AllPatches.push_back(current);
+  if (focus == -1 && selection.focusRow != -1 && !g_Patches.empty()) {
+    // The groups are gone; keep the cursor where it was
+    focus = std::min(selection.focusRow, (int)g_Patches.size() - 1);
+    ListView_SetItemState(hList, focus, LVIS_SELECTED, LVIS_SELECTED);
   }
+  if (focus != -1) {
+    ListView_SetItemState(hList, focus, LVIS_FOCUSED, LVIS_FOCUSED);
+    ListView_EnsureVisible(hList, focus, FALSE);
+  }
+}
 
-  // After sync, apply current filter to update g_Patches
-  ApplyFilter();
+// Replace the displayed list. The selection is taken while the rows still
+// match, for UpdateListView to select the same groups again.
+void SetPatchView(PatchView &view) {
+  if (!g_SelectionKept) {
+    SaveSelection(g_KeptSelection);
+    g_SelectionKept = true;
+  }
+  g_Patches.swap(view);
 }
 
+// Synchronous filter pass, for when the store has just changed
 void ApplyFilter() {
-  char filterBufOld[256] = {0};
-  char filterBufNew[256] = {0};
-
-  if (hFilterEditOld)
-    GetWindowText(hFilterEditOld, filterBufOld, 255);
-  if (hFilterEditNew)
-    GetWindowText(hFilterEditNew, filterBufNew, 255);
-
-  bool invOld = (hChkInverseOld &&
-                 SendMessage(hChkInverseOld, BM_GETCHECK, 0, 0) == BST_CHECKED);
-  bool invNew = (hChkInverseNew &&
-                 SendMessage(hChkInverseNew, BM_GETCHECK, 0, 0) == BST_CHECKED);
-
-  std::string fOld = filterBufOld;
-  std::string fNew = filterBufNew;
-
-  if (fOld.empty() && fNew.empty()) {
-    g_Patches = g_AllPatches;
-  } else {
-    try {
-      std::regex reOld(fOld.empty() ? ".*" : fOld, std::regex::icase);
-      std::regex reNew(fNew.empty() ? ".*" : fNew, std::regex::icase);
-
-      g_Patches.clear();
-      for (const auto &p : g_AllPatches) {
-        bool matchOld = std::regex_search(p.oldDisasm, reOld) ||
-                        std::regex_search(p.comment, reOld);
-        bool matchNew = std::regex_search(p.disasm, reNew);
-
-        bool passOld = true;
-        if (!fOld.empty()) {
-          passOld = invOld ? !matchOld : matchOld;
-        }
+  PatchFilter filter;
+  LoadFilter(filter);
+  PatchView view;
+  FilterNow(g_AllPatches, filter, view);
+  RemoveHiddenRows(view);
+  SetPatchView(view);
+  g_FilterPassPending = false;
+}
 
-        bool passNew = true;
-        if (!fNew.empty()) {
-          passNew = invNew ? !matchNew : matchNew;
-        }
+// Batch actions work on g_Patches; make sure it matches the filter boxes
+void FlushFilter() {
+  if (!g_FilterPassPending)
+    return;
+  ApplyFilter();
+  UpdateListView();
+}
 
-        if (passOld && passNew) {
-          g_Patches.push_back(p);
-        }
-      }
-    } catch (...) {
-      g_Patches = g_AllPatches;
-    }
+// Filter edits: run the pass on the filter worker. The list keeps showing
+// the previous result until WM_PATCH_FILTERED delivers the new one. While a
+// refresh streams rows in, the store keeps changing, so filter inline.
+void ApplyFilterAsync() {
+  if (IsPatchSyncRunning()) {
+    ApplyFilter();
+    UpdateListView();
+    return;
   }
+  PatchFilter filter;
+  LoadFilter(filter);
+  StartFilterPass(hPatchWindow, g_AllPatches, filter);
+  g_FilterPassPending = true;
+}
+
+void OnFilterPassDone(uint32_t pass) {
+  PatchView view;
+  if (!CollectFilterPass(pass, view))
+    return; // Superseded by a newer keystroke
+  g_FilterPassPending = false;
+  RemoveHiddenRows(view);
+  SetPatchView(view);
+  UpdateListView();
 }
 
 // Only refreshes the ListView using g_Patches (which should be already
-// filtered)
+// filtered). The list is owner-data: it holds just a row count and asks for
+// the text of the rows it paints via LVN_GETDISPINFO.
 void UpdateListView() {
   if (!hList)
     return;
-  // Restore selection and scrolling? For now simple redraw
-  int topIndex = ListView_GetTopIndex(hList);
-  int selected = ListView_GetNextItem(hList, -1, LVNI_SELECTED);
-
-  ListView_DeleteAllItems(hList);
-
-  LVITEM lvItem;
-  lvItem.mask = LVIF_TEXT | LVIF_PARAM;
-
-  for (int i = 0; i < (int)g_Patches.size(); ++i) {
-    const auto &patch = g_Patches[i];
-
-    std::stringstream ssAddr;
-    ssAddr << std::hex << std::uppercase << patch.address;
-    std::string addrStr = ssAddr.str();
+  // Row i may now show a different group; the selection follows the groups
+  ListSelection selection;
+  if (g_SelectionKept) {
+    selection = std::move(g_KeptSelection);
+    g_SelectionKept = false;
+  } else {
+    SaveSelection(selection);
+  }
 
-    lvItem.iItem = i;
-    lvItem.iSubItem = 0;
-    lvItem.pszText = (LPSTR)addrStr.c_str();
-    lvItem.lParam = (LPARAM)i; // Store index into g_Patches
-    ListView_InsertItem(hList, &lvItem);
+  ListView_SetItemCountEx(hList, (int)g_Patches.size(), LVSICF_NOSCROLL);
+  InvalidateRect(hList, NULL, TRUE);
+  RestoreSelection(selection);
+}
 
-    std::string oldBytesStr = BytesToHex(patch.oldBytes);
-    ListView_SetItemText(hList, i, 1, (LPSTR)oldBytesStr.c_str());
+// Show or hide the progress strip between the list and the filter boxes
+void ShowSyncProgress(bool show) {
+  if (!hPatchWindow || !hSyncProgress)
+    return;
+  ShowWindow(hSyncProgress, show ? SW_SHOW : SW_HIDE);
+  ShowWindow(hBtnCancelSync, show ? SW_SHOW : SW_HIDE);
+  if (show)
+    SendMessage(hSyncProgress, PBM_SETPOS, 0, 0);
+  LayoutPatchWindow(hPatchWindow);
+}
 
-    std::string newBytesStr = BytesToHex(patch.newBytes);
-    ListView_SetItemText(hList, i, 2, (LPSTR)newBytesStr.c_str());
+// Refresh runs on the sync worker; rows are added as WM_PATCH_SYNC arrives
+void RefreshPatchList(bool fullRebuild) {
+  if (!hPatchWindow)
+    return;
+  if (!IsPatchSyncRunning())
+    SaveSelection(g_SyncSelection);
+  if (fullRebuild)
+    g_HiddenPatches.clear();
+  InvalidateBreakpoints();
+
+  CancelFilterPass(); // The store is about to change under it
+  g_FilterPassPending = false; // Streamed rows use the current boxes
+  StartPatchSync(hPatchWindow, fullRebuild, g_AllPatches);
+  g_Patches.clear();
+  g_SelectionKept = false;
+  if (hList)
+    ListView_DeleteAllItems(hList);
+  ShowSyncProgress(true);
+}
 
-    ListView_SetItemText(hList, i, 3, (LPSTR)patch.oldDisasm.c_str());
-    ListView_SetItemText(hList, i, 4, (LPSTR)patch.disasm.c_str());
-    ListView_SetItemText(hList, i, 5, (LPSTR)patch.comment.c_str());
+void OnPatchSyncProgress() {
+  CancelFilterPass();
+  size_t first = g_AllPatches.size();
+  SyncProgress progress = CollectPatchSync(g_AllPatches);
+  if (progress.state == SYNC_IDLE)
+    return; // Stale notification from a cancelled sync
+
+  if (progress.state == SYNC_FAILED) {
+    // Keep the previous list
+    ApplyFilter();
+    UpdateListView();
+  } else if (hList && first < g_AllPatches.size()) {
+    PatchFilter filter;
+    bool filtered = LoadFilter(filter);
+    for (size_t i = first; i < g_AllPatches.size(); ++i) {
+      if ((filtered && !filter.Matches(g_AllPatches, i)) || IsHiddenPatch(i))
+        continue;
+      g_Patches.push_back((uint32_t)i);
+    }
+    // Rows already shown are unchanged; only the new ones get painted
+    ListView_SetItemCountEx(hList, (int)g_Patches.size(),
+                            LVSICF_NOINVALIDATEALL | LVSICF_NOSCROLL);
   }
 
-  // Restore selection if possible (by index)
-  if (selected != -1 && selected < (int)g_Patches.size()) {
-    ListView_SetItemState(hList, selected, LVIS_SELECTED | LVIS_FOCUSED,
-                          LVIS_SELECTED | LVIS_FOCUSED);
-    ListView_EnsureVisible(hList, selected, FALSE);
+  if (progress.state == SYNC_RUNNING) {
+    if (progress.total > 0) {
+      SendMessage(hSyncProgress, PBM_SETRANGE32, 0, (LPARAM)progress.total);
+      SendMessage(hSyncProgress, PBM_SETPOS, (WPARAM)progress.done, 0);
+    }
+    return;
   }
-}
 
-void RefreshPatchList() {
-  SyncPatchesFromDebugger();
-  UpdateListView();
+  ShowSyncProgress(false);
+  if (progress.state == SYNC_DONE && !g_AllPatches.empty()) {
+    size_t usage = g_AllPatches.MemoryUsage();
+    Log("[PatchMgr] Patch store: %d groups, %d KB (%d bytes/group), "
+        "search shadows %d KB, trigram index %d KB\n",
+        (int)g_AllPatches.size(), (int)(usage / 1024),
+        (int)(usage / g_AllPatches.size()),
+        (int)(g_AllPatches.FoldedMemoryUsage() / 1024),
+        (int)(g_AllPatches.Trigrams().MemoryUsage() / 1024));
+  }
+  RestoreSelection(g_SyncSelection);
 
   // Force full window redraw to update custom draw states
   // (backgrounds/breakpoints)
@@ -453,6 +384,69 @@ void RefreshPatchList() {
     InvalidateRect(hPatchWindow, NULL, TRUE);
 }
 
+// Auto-refresh state. The window handle and the pending flag are touched by
+// debugger threads; the rest only on the GUI thread.
+static std::atomic<HWND> g_AutoRefreshWnd{NULL}; // NULL while closed
+static std::atomic<bool> g_AutoRefreshPosted{false};
+static std::atomic<unsigned int> g_AutoRefreshInterval{
+    AUTOREFRESH_DEFAULT_INTERVAL};
+static DWORD g_LastAutoRefresh = 0;
+static bool g_AutoRefreshTimer = false;
+
+void RequestAutoRefresh() {
+  HWND hwnd = g_AutoRefreshWnd;
+  if (!hwnd || g_AutoRefreshInterval == 0)
+    return;
+  // One message in flight is enough, the GUI side debounces the rest
+  if (!g_AutoRefreshPosted.exchange(true))
+    PostMessage(hwnd, WM_PATCH_AUTOREFRESH, 0, 0);
+}
+
+void SetAutoRefreshInterval(unsigned int ms) { g_AutoRefreshInterval = ms; }
+
+unsigned int GetAutoRefreshInterval() { return g_AutoRefreshInterval; }
+
+static void RunAutoRefresh() {
+  g_LastAutoRefresh = GetTickCount();
+  RefreshPatchList();
+}
+
+// Leading edge refreshes right away; requests inside the interval are folded
+// into one trailing refresh when it expires
+void OnAutoRefreshRequest(HWND hwnd) {
+  g_AutoRefreshPosted = false;
+  unsigned int interval = g_AutoRefreshInterval;
+  if (interval == 0 || g_AutoRefreshTimer)
+    return;
+  DWORD elapsed = GetTickCount() - g_LastAutoRefresh;
+  if (elapsed >= interval) {
+    RunAutoRefresh();
+    return;
+  }
+  SetTimer(hwnd, IDT_AUTOREFRESH, interval - elapsed, NULL);
+  g_AutoRefreshTimer = true;
+}
+
+void OnAutoRefreshTimer(HWND hwnd) {
+  KillTimer(hwnd, IDT_AUTOREFRESH);
+  g_AutoRefreshTimer = false;
+  if (g_AutoRefreshInterval != 0)
+    RunAutoRefresh();
+}
+
+// Cancel button: drop the partial result and go back to the previous list
+void CancelRefresh() {
+  if (!IsPatchSyncRunning())
+    return;
+  CancelFilterPass();
+  CancelPatchSync(g_AllPatches);
+  ApplyFilter();
+  UpdateListView();
+  RestoreSelection(g_SyncSelection);
+  ShowSyncProgress(false);
+  Log("[PatchMgr] Refresh cancelled\n");
+}
+
 extern "C" __declspec(dllimport) void GuiDisasmAt(duint addr, duint cip);
 extern "C" __declspec(dllimport) void GuiUpdateAllViews();
 extern "C" __declspec(dllimport) void GuiUpdateDisassemblyView();
@@ -462,58 +456,176 @@ bool ImportAndApplyPatches(const char *filepath);
 bool ExportPatches(const char *filepath);
 bool GetFileNameFromUser(char *buffer, int maxLen, bool save);
 
-bool ApplyPatch(const PatchInfo &patch) {
-  if (patch.newBytes.empty())
-    return false;
-  const DBGFUNCTIONS *funcs = DbgFunctions();
-  return (funcs && funcs->MemPatch)
-             ? funcs->MemPatch(patch.address, patch.newBytes.data(),
-                               patch.newBytes.size())
-             : false;
+// Set or clear the breakpoint at 'addr' without refreshing any view
+static bool SetBreakpoint(duint addr, bool set) {
+  char cmd[64];
+  snprintf(cmd, sizeof(cmd), "%s 0x%llX", set ? "bp" : "bc",
+           (unsigned long long)addr);
+  return DbgCmdExecDirect(cmd);
 }
 
-bool RestorePatch(const PatchInfo &patch) {
-  if (patch.oldBytes.empty())
-    return false;
-  const DBGFUNCTIONS *funcs = DbgFunctions();
-  return (funcs && funcs->MemPatch)
-             ? funcs->MemPatch(patch.address, patch.oldBytes.data(),
-                               patch.oldBytes.size())
-             : false;
+// Repaint the debugger views and the list after breakpoints changed
+static void OnBreakpointsChanged() {
+  InvalidateBreakpoints();
+  GuiUpdateAllViews();
+  GuiUpdateDisassemblyView();
+  GuiRepaintTableView(); // Explicit repaint
+
+  // Force redraw of list to update Red highlight immediately
+  if (hList)
+    InvalidateRect(hList, NULL, TRUE);
 }
 
 void ToggleBreakpoint(duint addr) {
-  BPXTYPE bpType = DbgGetBpxTypeAt(addr);
-  char cmd[64];
+  // Breakpoint exists -> Cancel it (bc), otherwise set it (bp)
+  SetBreakpoint(addr, DbgGetBpxTypeAt(addr) == bp_none);
+  OnBreakpointsChanged();
+}
 
-  if (bpType != bp_none) {
-    // Breakpoint exists -> Cancel it (bc)
-    sprintf(cmd, "bc 0x%X", (unsigned int)addr);
-  } else {
-    // No breakpoint -> Set it (bp)
-    sprintf(cmd, "bp 0x%X", (unsigned int)addr);
+// Hold off debugger view updates during a batch; nests with a caller that
+// already did. Pass the result to EndGuiBatch.
+static bool BeginGuiBatch() {
+  bool wasDisabled = GuiIsUpdateDisabled();
+  if (!wasDisabled)
+    GuiUpdateDisable();
+  return wasDisabled;
+}
+
+static void EndGuiBatch(bool wasDisabled) {
+  if (!wasDisabled)
+    GuiUpdateEnable(false); // The caller refreshes once
+}
+
+// Toggle the breakpoint at the head of each group (indices into
+// g_AllPatches). Heads are taken from one breakpoint snapshot and commands
+// are issued with GUI updates off, so the debugger repaints once at the end.
+// The counts are always logged; 'showReport' also shows them.
+void ToggleBreakpoints(HWND hwnd, const PatchView &indices, bool showReport) {
+  if (indices.empty()) {
+    MessageBoxA(hwnd, "No patches in the current list.", "Toggle BPs",
+                MB_ICONINFORMATION);
+    return;
+  }
+
+  // Groups sharing a head would toggle it back
+  std::vector<duint> heads;
+  std::unordered_set<duint> seen;
+  heads.reserve(indices.size());
+  for (uint32_t index : indices) {
+    if (seen.insert(g_AllPatches.Head(index)).second)
+      heads.push_back(g_AllPatches.Head(index));
+  }
+
+  InvalidateBreakpoints(); // Take a fresh snapshot below
+  int setCount = 0;
+  int clearCount = 0;
+  int failCount = 0;
+  bool wasDisabled = BeginGuiBatch();
+  for (duint head : heads) {
+    bool set = !HasBreakpoint(head);
+    if (!SetBreakpoint(head, set))
+      failCount++;
+    else if (set)
+      setCount++;
+    else
+      clearCount++;
+  }
+  EndGuiBatch(wasDisabled);
+  OnBreakpointsChanged();
+
+  Log("[PatchMgr] Toggle BPs: %d set, %d cleared, %d failed\n", setCount,
+      clearCount, failCount);
+  if (!showReport)
+    return;
+  char msg[256];
+  snprintf(msg, sizeof(msg),
+           "Breakpoints toggled.\n\nSet: %d\nCleared: %d\nFailed: %d",
+           setCount, clearCount, failCount);
+  MessageBoxA(hwnd, msg, "Toggle BPs Result", MB_ICONINFORMATION);
+}
+
+// Restore the given groups (indices into g_AllPatches) to their old bytes
+// after asking the user. 'scope' completes "Remove all N patches ...".
+void RemovePatchGroups(HWND hwnd, const PatchView &indices,
+                       const char *scope) {
+  char msg[MAX_MODULE_SIZE + 256];
+  if (indices.empty()) {
+    snprintf(msg, sizeof(msg), "No patches %s to remove.", scope);
+    MessageBoxA(hwnd, msg, "Remove All", MB_ICONINFORMATION);
+    return;
+  }
+
+  snprintf(msg, sizeof(msg),
+           "Remove all %d patches %s from the "
+           "debugger?\n\nThis will restore them to their original bytes.",
+           (int)indices.size(), scope);
+  int result =
+      MessageBoxA(hwnd, msg, "Confirm Remove All", MB_YESNO | MB_ICONQUESTION);
+  if (result != IDYES)
+    return;
+
+  const DBGFUNCTIONS *dbgFuncs = DbgFunctions();
+  if (!dbgFuncs || !dbgFuncs->MemPatch) {
+    MessageBoxA(hwnd, "MemPatch API not available", "Error", MB_ICONERROR);
+    return;
   }
 
-  DbgCmdExecDirect(cmd);
+  // Restore each patch to its old bytes, neighbouring groups in one call
+  std::vector<PatchWrite> writes;
+  writes.reserve(indices.size());
+  for (uint32_t index : indices) {
+    PatchWrite w = {g_AllPatches.Address(index), g_AllPatches.OldBytes(index),
+                    g_AllPatches.ByteCount(index)};
+    writes.push_back(w);
+  }
+  std::vector<bool> restored;
+  PatchWriteStats stats = RestorePatchWrites(writes, restored);
+  int successCount = (int)std::count(restored.begin(), restored.end(), true);
+  int failCount = (int)restored.size() - successCount;
+  Log("[PatchMgr] Restored %d groups in %d ranges (%d ranges with "
+      "failures)\n",
+      successCount, stats.ranges, stats.rangesFailed);
+
+  InvalidateMemCache();
   GuiUpdateAllViews();
-  GuiUpdateDisassemblyView();
-  GuiRepaintTableView(); // Explicit repaint
+  RefreshPatchList();
 
-  // Force redraw of list to update Red highlight immediately
-  if (hList)
-    InvalidateRect(hList, NULL, TRUE);
+  snprintf(msg, sizeof(msg),
+           "Batch removal complete.\n\nRestored: %d\nFailed: %d",
+           successCount, failCount);
+  MessageBoxA(hwnd, msg, "Remove All Result", MB_ICONINFORMATION);
 }
 
 // --- Menu & Input Helper Functions ---
 
-void ExecuteAction(HWND hwnd, int commandID, int selectedIndex) {
-  if (selectedIndex < 0 || selectedIndex >= (int)g_Patches.size())
+// F2: one row toggles as before, a selection goes through the batch
+void ToggleSelectedBreakpoints(HWND hwnd) {
+  std::vector<int> rows;
+  GetSelectedRows(rows);
+  if (rows.size() == 1) {
+    ToggleBreakpoint(g_AllPatches.Head(g_Patches[rows[0]]));
+  } else if (!rows.empty()) {
+    PatchView indices;
+    indices.reserve(rows.size());
+    for (int row : rows)
+      indices.push_back(g_Patches[row]);
+    ToggleBreakpoints(hwnd, indices, false);
+  }
+}
+
+// Row actions work on the whole selection as one batch: one coalesced
+// write, one memory cache invalidation and one GUI update
+void ExecuteAction(HWND hwnd, int commandID) {
+  std::vector<int> rows;
+  GetSelectedRows(rows);
+  if (rows.empty() || rows.back() >= (int)g_Patches.size())
     return;
 
-  // Auto-advance helper
+  // Auto-advance helper: a single selected row moves on to the next one
   auto AutoAdvance = [&]() {
-    if (selectedIndex < ListView_GetItemCount(hList) - 1) {
-      int next = selectedIndex + 1;
+    if (rows.size() == 1 && rows[0] < ListView_GetItemCount(hList) - 1) {
+      int next = rows[0] + 1;
+      ListView_SetItemState(hList, rows[0], 0, LVIS_SELECTED | LVIS_FOCUSED);
       ListView_SetItemState(hList, next, LVIS_SELECTED | LVIS_FOCUSED,
                             LVIS_SELECTED | LVIS_FOCUSED);
       ListView_EnsureVisible(hList, next, FALSE);
@@ -521,47 +633,80 @@ void ExecuteAction(HWND hwnd, int commandID, int selectedIndex) {
   };
 
   switch (commandID) {
-  case ID_MENU_DISASM:
-    GuiDisasmAt(g_Patches[selectedIndex].head,
-                g_Patches[selectedIndex].address);
+  case ID_MENU_DISASM: {
+    size_t index = g_Patches[GetFocusRow()];
+    GuiDisasmAt(g_AllPatches.Head(index), g_AllPatches.Address(index));
     GuiUpdateAllViews();
     break;
+  }
   case ID_MENU_APPLY:
-    if (ApplyPatch(g_Patches[selectedIndex])) {
-      Log("[PatchMgr] Applied %p\n", g_Patches[selectedIndex].address);
-      GuiUpdateAllViews();
-      if (hList)
-        InvalidateRect(hList, NULL, TRUE); // Redraw
-      AutoAdvance();
-    }
-    break;
-  case ID_MENU_RESTORE:
-    if (RestorePatch(g_Patches[selectedIndex])) {
-      Log("[PatchMgr] Restored %p\n", g_Patches[selectedIndex].address);
-      GuiUpdateAllViews();
-      if (hList)
-        InvalidateRect(hList, NULL, TRUE); // Redraw
-      AutoAdvance();
+  case ID_MENU_RESTORE: {
+    bool apply = commandID == ID_MENU_APPLY;
+    std::vector<PatchWrite> writes;
+    writes.reserve(rows.size());
+    for (int row : rows) {
+      size_t index = g_Patches[row];
+      PatchWrite w = {g_AllPatches.Address(index),
+                      apply ? g_AllPatches.NewBytes(index)
+                            : g_AllPatches.OldBytes(index),
+                      g_AllPatches.ByteCount(index)};
+      writes.push_back(w);
     }
+    std::vector<bool> ok;
+    bool wasDisabled = BeginGuiBatch();
+    if (apply)
+      ApplyPatchWrites(writes, ok);
+    else
+      RestorePatchWrites(writes, ok);
+    EndGuiBatch(wasDisabled);
+    InvalidateMemCache();
+
+    int done = (int)std::count(ok.begin(), ok.end(), true);
+    if (done == 0)
+      break;
+    if (rows.size() == 1)
+      Log("[PatchMgr] %s %p\n", apply ? "Applied" : "Restored",
+          (void *)writes[0].address);
+    else
+      Log("[PatchMgr] %s %d of %d patches\n", apply ? "Applied" : "Restored",
+          done, (int)rows.size());
+    GuiUpdateAllViews();
+    if (hList)
+      InvalidateRect(hList, NULL, TRUE); // Redraw
+    AutoAdvance();
     break;
-  case ID_MENU_DELETE:
-    if (selectedIndex >= 0 && selectedIndex < (int)g_Patches.size()) {
-      g_Patches.erase(g_Patches.begin() + selectedIndex);
-      UpdateListView();
-
-      // Restore selection
-      int newCount = (int)g_Patches.size();
-      if (newCount > 0) {
-        int newSel = selectedIndex;
-        if (newSel >= newCount)
-          newSel = newCount - 1;
-        ListView_SetItemState(hList, newSel, LVIS_SELECTED | LVIS_FOCUSED,
-                              LVIS_SELECTED | LVIS_FOCUSED);
-        ListView_EnsureVisible(hList, newSel, FALSE);
+  }
+  case ID_MENU_DELETE: {
+    for (int row : rows)
+      g_HiddenPatches.insert(g_AllPatches.Address(g_Patches[row]));
+    // Both ascending: drop the selected rows in one pass
+    size_t out = 0;
+    size_t next = 0;
+    for (size_t k = 0; k < g_Patches.size(); ++k) {
+      if (next < rows.size() && rows[next] == (int)k) {
+        ++next;
+        continue;
       }
+      g_Patches[out++] = g_Patches[k];
+    }
+    g_Patches.resize(out);
+    ListView_SetItemState(hList, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+    ListView_SetItemCountEx(hList, (int)g_Patches.size(), LVSICF_NOSCROLL);
+    InvalidateRect(hList, NULL, TRUE);
+
+    // Restore selection: the row that took the first hidden one's place
+    int newCount = (int)g_Patches.size();
+    if (newCount > 0) {
+      int newSel = rows[0];
+      if (newSel >= newCount)
+        newSel = newCount - 1;
+      ListView_SetItemState(hList, newSel, LVIS_SELECTED | LVIS_FOCUSED,
+                            LVIS_SELECTED | LVIS_FOCUSED);
+      ListView_EnsureVisible(hList, newSel, FALSE);
     }
     break;
   }
+  }
 }
 
 void ShowContextMenu(HWND hwnd, POINT pt) {
@@ -570,19 +715,36 @@ void ShowContextMenu(HWND hwnd, POINT pt) {
   AppendMenu(hMenu, MF_STRING, ID_MENU_SAVE, "Export Patch File...\tCtrl+S");
   AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
   AppendMenu(hMenu, MF_STRING, ID_MENU_REFRESH, "Refresh\tF5");
+  AppendMenu(hMenu, MF_STRING, ID_MENU_FULL_REFRESH,
+             "Full Refresh\tCtrl+F5");
   AppendMenu(hMenu, MF_STRING, ID_MENU_REMOVE_ALL_IN_LIST,
              "Remove All in List");
 
   int iItem = ListView_GetNextItem(hList, -1, LVNI_SELECTED);
   if (iItem != -1) {
+    int selected = (int)ListView_GetSelectedCount(hList);
+    char apply[64], restore[64], hide[64], toggle[64];
+    if (selected > 1) {
+      snprintf(apply, sizeof(apply), "Apply %d Patches\tSpace", selected);
+      snprintf(restore, sizeof(restore), "Restore %d Patches\tEsc", selected);
+      snprintf(hide, sizeof(hide), "Hide %d Entries Now\tDel", selected);
+      snprintf(toggle, sizeof(toggle), "Toggle %d Breakpoints\tF2", selected);
+    } else {
+      snprintf(apply, sizeof(apply), "Apply Patch\tSpace");
+      snprintf(restore, sizeof(restore), "Restore Patch\tEsc");
+      snprintf(hide, sizeof(hide), "Hide Entry Now\tDel");
+      snprintf(toggle, sizeof(toggle), "Toggle Breakpoint\tF2");
+    }
     AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
     AppendMenu(hMenu, MF_STRING, ID_MENU_DISASM,
                "Follow in Disassembler\tEnter");
-    AppendMenu(hMenu, MF_STRING, ID_MENU_APPLY, "Apply Patch\tSpace");
-    AppendMenu(hMenu, MF_STRING, ID_MENU_RESTORE, "Restore Patch\tEsc");
-    AppendMenu(hMenu, MF_STRING, ID_MENU_DELETE, "Hide Entry Now\tDel");
-    AppendMenu(hMenu, MF_STRING, 5555, "Toggle Breakpoint\tF2");
+    AppendMenu(hMenu, MF_STRING, ID_MENU_APPLY, apply);
+    AppendMenu(hMenu, MF_STRING, ID_MENU_RESTORE, restore);
+    AppendMenu(hMenu, MF_STRING, ID_MENU_DELETE, hide);
+    AppendMenu(hMenu, MF_STRING, 5555, toggle);
     AppendMenu(hMenu, MF_STRING, ID_MENU_TOGGLE_BPS_ALL, "Toggle BPs to All");
+    AppendMenu(hMenu, MF_STRING, ID_MENU_REMOVE_MODULE,
+               "Remove All in Module");
   }
 
   int cmd = TrackPopupMenu(hMenu, TPM_RETURNCMD | TPM_RIGHTBUTTON, pt.x, pt.y,
@@ -590,11 +752,10 @@ void ShowContextMenu(HWND hwnd, POINT pt) {
   DestroyMenu(hMenu);
 
   if (cmd == 5555 && iItem != -1) {
-    ToggleBreakpoint(g_Patches[iItem].head);
+    ToggleSelectedBreakpoints(hwnd);
   } else if (cmd == ID_MENU_TOGGLE_BPS_ALL) {
-    for (const auto &p : g_Patches) {
-      ToggleBreakpoint(p.head);
-    }
+    FlushFilter();
+    ToggleBreakpoints(hwnd, g_Patches, true);
   } else if (cmd != 0) {
     SendMessage(hwnd, WM_COMMAND, cmd, 0);
   }
@@ -635,7 +796,13 @@ LRESULT CALLBACK PatchListSubclassProc(HWND hwnd, UINT msg, WPARAM wParam,
       break;
     case VK_F2:
       if (iItem != -1) {
-        ToggleBreakpoint(g_Patches[iItem].head);
+        ToggleSelectedBreakpoints(GetParent(hwnd));
+        return 0;
+      }
+      break;
+    case 'A':
+      if (ctrl) {
+        ListView_SetItemState(hwnd, -1, LVIS_SELECTED, LVIS_SELECTED);
         return 0;
       }
       break;
@@ -652,7 +819,9 @@ LRESULT CALLBACK PatchListSubclassProc(HWND hwnd, UINT msg, WPARAM wParam,
       }
       break;
     case VK_F5:
-      SendMessage(GetParent(hwnd), WM_COMMAND, ID_MENU_REFRESH, 0);
+      // Ctrl+F5 re-resolves every group (picks up edited comments/labels)
+      SendMessage(GetParent(hwnd), WM_COMMAND,
+                  ctrl ? ID_MENU_FULL_REFRESH : ID_MENU_REFRESH, 0);
       return 0;
     }
   } break;
@@ -660,6 +829,42 @@ LRESULT CALLBACK PatchListSubclassProc(HWND hwnd, UINT msg, WPARAM wParam,
   return CallWindowProc(oldListWndProc, hwnd, msg, wParam, lParam);
 }
 
+void LayoutPatchWindow(HWND hwnd) {
+  RECT rc;
+  GetClientRect(hwnd, &rc);
+  int editHeight = 35;
+  int chkWidth = 70;
+  int spacing = 5;
+  int progressHeight = 22;
+  int halfWidth = rc.right / 2;
+
+  if (hList && hFilterEditOld && hFilterEditNew && hChkInverseOld &&
+      hChkInverseNew) {
+    int listHeight = rc.bottom - editHeight;
+    if (IsPatchSyncRunning() && hSyncProgress && hBtnCancelSync) {
+      // Progress strip: [Progress Bar][Cancel]
+      listHeight -= progressHeight;
+      SetWindowPos(hSyncProgress, NULL, 0, listHeight, rc.right - chkWidth,
+                   progressHeight, SWP_NOZORDER);
+      SetWindowPos(hBtnCancelSync, NULL, rc.right - chkWidth, listHeight,
+                   chkWidth, progressHeight, SWP_NOZORDER);
+    }
+    SetWindowPos(hList, NULL, 0, 0, rc.right, listHeight, SWP_NOZORDER);
+
+    // Left Group: [Filter Edit Old][Gap][Inv Checkbox]
+    SetWindowPos(hFilterEditOld, NULL, 0, rc.bottom - editHeight,
+                 halfWidth - chkWidth - spacing, editHeight, SWP_NOZORDER);
+    SetWindowPos(hChkInverseOld, NULL, halfWidth - chkWidth,
+                 rc.bottom - editHeight, chkWidth, editHeight, SWP_NOZORDER);
+
+    // Right Group: [Filter Edit New][Gap][Inv Checkbox]
+    SetWindowPos(hFilterEditNew, NULL, halfWidth, rc.bottom - editHeight,
+                 halfWidth - chkWidth - spacing, editHeight, SWP_NOZORDER);
+    SetWindowPos(hChkInverseNew, NULL, rc.right - chkWidth,
+                 rc.bottom - editHeight, chkWidth, editHeight, SWP_NOZORDER);
+  }
+}
+
 // Main Window Procedure
 LRESULT CALLBACK PatchWndProc(HWND hwnd, UINT msg, WPARAM wParam,
                               LPARAM lParam) {
@@ -705,8 +910,16 @@ LRESULT CALLBACK PatchWndProc(HWND hwnd, UINT msg, WPARAM wParam,
                      rc.right - chkWidth, rc.bottom - editHeight, chkWidth,
                      editHeight, hwnd, (HMENU)ID_CHK_INVERSE_NEW, hInst, NULL);
 
+    // 5. Refresh progress strip (hidden until a refresh runs)
+    hSyncProgress = CreateWindowEx(0, PROGRESS_CLASS, "", WS_CHILD | PBS_SMOOTH,
+                                   0, 0, 0, 0, hwnd,
+                                   (HMENU)IDC_SYNC_PROGRESS, hInst, NULL);
+    hBtnCancelSync =
+        CreateWindow("BUTTON", "Cancel", WS_CHILD, 0, 0, 0, 0, hwnd,
+                     (HMENU)IDC_BTN_CANCEL_SYNC, hInst, NULL);
+
     hList = CreateWindowEx(0, WC_LISTVIEW, "",
-                           WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_SINGLESEL,
+                           WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_OWNERDATA,
                            0, 0, rc.right, rc.bottom - editHeight, hwnd,
                            (HMENU)IDC_LIST_PATCHES, hInst, NULL);
 
@@ -755,41 +968,40 @@ LRESULT CALLBACK PatchWndProc(HWND hwnd, UINT msg, WPARAM wParam,
     ListView_InsertColumn(hList, 5, &lvc);
     break;
   }
-  case WM_SIZE: {
-    RECT rc;
-    GetClientRect(hwnd, &rc);
-    int editHeight = 35;
-    int chkWidth = 70;
-    int spacing = 5;
-    int halfWidth = rc.right / 2;
-
-    if (hList && hFilterEditOld && hFilterEditNew && hChkInverseOld &&
-        hChkInverseNew) {
-      SetWindowPos(hList, NULL, 0, 0, rc.right, rc.bottom - editHeight,
-                   SWP_NOZORDER);
-
-      // Left Group: [Filter Edit Old][Gap][Inv Checkbox]
-      SetWindowPos(hFilterEditOld, NULL, 0, rc.bottom - editHeight,
-                   halfWidth - chkWidth - spacing, editHeight, SWP_NOZORDER);
-      SetWindowPos(hChkInverseOld, NULL, halfWidth - chkWidth,
-                   rc.bottom - editHeight, chkWidth, editHeight, SWP_NOZORDER);
-
-      // Right Group: [Filter Edit New][Gap][Inv Checkbox]
-      SetWindowPos(hFilterEditNew, NULL, halfWidth, rc.bottom - editHeight,
-                   halfWidth - chkWidth - spacing, editHeight, SWP_NOZORDER);
-      SetWindowPos(hChkInverseNew, NULL, rc.right - chkWidth,
-                   rc.bottom - editHeight, chkWidth, editHeight, SWP_NOZORDER);
-    }
+  case WM_SIZE:
+    LayoutPatchWindow(hwnd);
+    break;
+  case WM_PATCH_SYNC:
+    OnPatchSyncProgress();
+    break;
+  case WM_PATCH_FILTERED:
+    OnFilterPassDone((uint32_t)wParam);
+    break;
+  case WM_PATCH_AUTOREFRESH:
+    OnAutoRefreshRequest(hwnd);
+    break;
+  case WM_TIMER:
+    if (wParam == IDT_AUTOREFRESH)
+      OnAutoRefreshTimer(hwnd);
     break;
-  }
   case WM_NOTIFY: {
     LPNMHDR pnmh = (LPNMHDR)lParam;
     if (pnmh->idFrom == IDC_LIST_PATCHES) {
       switch (pnmh->code) {
-      case NM_DBLCLK: {
-        int iItem = ListView_GetNextItem(hList, -1, LVNI_SELECTED);
-        if (iItem != -1)
-          ExecuteAction(hwnd, ID_MENU_DISASM, iItem);
+      case NM_DBLCLK:
+        ExecuteAction(hwnd, ID_MENU_DISASM);
+        break;
+      case LVN_GETDISPINFO: {
+        NMLVDISPINFO *pdi = (NMLVDISPINFO *)lParam;
+        int iItem = pdi->item.iItem;
+        if ((pdi->item.mask & LVIF_TEXT) && pdi->item.cchTextMax > 0) {
+          const char *text = "";
+          if (iItem >= 0 && iItem < (int)g_Patches.size() &&
+              pdi->item.iSubItem >= 0 && pdi->item.iSubItem < COLUMN_COUNT)
+            text = g_RowCache.Text(g_AllPatches, g_Patches[iItem],
+                                   (PatchColumn)pdi->item.iSubItem);
+          lstrcpyn(pdi->item.pszText, text, pdi->item.cchTextMax);
+        }
         break;
       }
       case NM_RCLICK: {
@@ -801,13 +1013,24 @@ LRESULT CALLBACK PatchWndProc(HWND hwnd, UINT msg, WPARAM wParam,
       case NM_CUSTOMDRAW: {
         LPNMLVCUSTOMDRAW pnmcd = (LPNMLVCUSTOMDRAW)lParam;
         switch (pnmcd->nmcd.dwDrawStage) {
-        case CDDS_PREPAINT:
+        case CDDS_PREPAINT: {
+          // Memory isn't cached while the debuggee runs; read it each paint
+          if (DbgIsRunning())
+            g_StateCache.clear();
+          int top = ListView_GetTopIndex(hList);
+          int count = ListView_GetCountPerPage(hList) + 1; // Partial row
+          if (top >= 0)
+            g_StateCache.Update(g_AllPatches, g_Patches, (size_t)top,
+                                (size_t)top + count);
           return CDRF_NOTIFYITEMDRAW;
+        }
         case CDDS_ITEMPREPAINT:
           return CDRF_NOTIFYSUBITEMDRAW;
         case CDDS_ITEMPREPAINT | CDDS_SUBITEM: {
           int iItem = (int)pnmcd->nmcd.dwItemSpec;
           if (iItem >= 0 && iItem < (int)g_Patches.size()) {
+            const PatchStore &store = g_AllPatches;
+            size_t index = g_Patches[iItem];
 
             // Initialize standard colors
             COLORREF textColor = RGB(0, 0, 0);     // Default Black
@@ -816,8 +1039,7 @@ LRESULT CALLBACK PatchWndProc(HWND hwnd, UINT msg, WPARAM wParam,
             // 1. Breakpoint Highlight (Highest Priority for Text Color)
             // Applied to Address Column (subitem 0)
             if (pnmcd->iSubItem == 0) {
-              BPXTYPE bpType = DbgGetBpxTypeAt(g_Patches[iItem].head);
-              if (bpType != bp_none) {
+              if (HasBreakpoint(store.Head(index))) {
                 bkColor = RGB(255, 100, 100); // Red Background
                 textColor =
                     RGB(0, 0, 255); // Bright Blue Text (Distinct from Black)
@@ -839,18 +1061,14 @@ LRESULT CALLBACK PatchWndProc(HWND hwnd, UINT msg, WPARAM wParam,
             // 2. State Coloring (Yellow) - Mutually Exclusive (New vs Old)
             // Only affects Data columns (1-4)
             if (pnmcd->iSubItem >= 1 && pnmcd->iSubItem <= 4) {
-              bool matchesNew = IsMemoryMatching(g_Patches[iItem].address,
-                                                 g_Patches[iItem].newBytes);
-              bool matchesOld = IsMemoryMatching(g_Patches[iItem].address,
-                                                 g_Patches[iItem].oldBytes);
-
-              if (matchesNew) {
+              PatchState state = g_StateCache.Get(store, index);
+              if (state == PATCH_APPLIED) {
                 if (pnmcd->iSubItem == 2 ||
                     pnmcd->iSubItem == 4) {     // New Bytes or New Disasm
                   bkColor = RGB(255, 255, 224); // Light Yellow
                   textColor = RGB(0, 100, 0);   // Dark Green
                 }
-              } else if (matchesOld) {
+              } else if (state == PATCH_ORIGINAL) {
                 if (pnmcd->iSubItem == 1 ||
                     pnmcd->iSubItem == 3) {     // Old Bytes or Old Disasm
                   bkColor = RGB(255, 255, 224); // Light Yellow
@@ -889,19 +1107,20 @@ LRESULT CALLBACK PatchWndProc(HWND hwnd, UINT msg, WPARAM wParam,
     switch (LOWORD(wParam)) {
     case IDC_EDIT_FILTER_OLD:
     case IDC_EDIT_FILTER_NEW:
-      if (HIWORD(wParam) == EN_CHANGE) {
-        ApplyFilter();
-        UpdateListView(); // Update ListView directly
-      }
+      if (HIWORD(wParam) == EN_CHANGE)
+        ApplyFilterAsync();
       break;
 
     case ID_CHK_INVERSE_OLD:
     case ID_CHK_INVERSE_NEW:
       // Only respond to click events
-      if (HIWORD(wParam) == BN_CLICKED) {
-        ApplyFilter();
-        UpdateListView();
-      }
+      if (HIWORD(wParam) == BN_CLICKED)
+        ApplyFilterAsync();
+      break;
+
+    case IDC_BTN_CANCEL_SYNC:
+      if (HIWORD(wParam) == BN_CLICKED)
+        CancelRefresh();
       break;
 
     case ID_MENU_LOAD: {
@@ -915,85 +1134,79 @@ LRESULT CALLBACK PatchWndProc(HWND hwnd, UINT msg, WPARAM wParam,
     }
     case ID_MENU_SAVE: {
       char filepath[MAX_PATH];
-      if (GetFileNameFromUser(filepath, MAX_PATH, true))
+      if (GetFileNameFromUser(filepath, MAX_PATH, true)) {
+        FlushFilter();
         ExportPatches(filepath);
+      }
       break;
     }
     case ID_MENU_REFRESH: {
       RefreshPatchList();
       break;
     }
+    case ID_MENU_FULL_REFRESH: {
+      RefreshPatchList(true);
+      break;
+    }
 
-    case ID_MENU_REMOVE_ALL_IN_LIST: {
+    case ID_MENU_REMOVE_ALL_IN_LIST:
       // Remove all patches that are currently visible in the filtered list
-      if (g_Patches.empty()) {
-        MessageBoxA(hwnd, "No patches in the current list to remove.",
-                    "Remove All", MB_ICONINFORMATION);
-        break;
-      }
-
-      char msg[256];
-      sprintf(msg,
-              "Remove all %d patches in the current list from the "
-              "debugger?\n\nThis will restore them to their original bytes.",
-              (int)g_Patches.size());
-      int result = MessageBoxA(hwnd, msg, "Confirm Remove All",
-                               MB_YESNO | MB_ICONQUESTION);
-
-      if (result == IDYES) {
-        const DBGFUNCTIONS *dbgFuncs = DbgFunctions();
-        if (!dbgFuncs || !dbgFuncs->MemPatch) {
-          MessageBoxA(hwnd, "MemPatch API not available", "Error",
-                      MB_ICONERROR);
-          break;
-        }
-
-        int successCount = 0;
-        int failCount = 0;
-
-        // Restore each patch to its old bytes
-        for (const auto &patch : g_Patches) {
-          bool allRestored = true;
-          for (size_t k = 0; k < patch.oldBytes.size(); ++k) {
-            duint addr = patch.address + k;
-            unsigned char oldByte = patch.oldBytes[k];
-            if (!dbgFuncs->MemPatch(addr, &oldByte, 1)) {
-              allRestored = false;
-            }
-          }
-          if (allRestored) {
-            successCount++;
-          } else {
-            failCount++;
-          }
-        }
-
-        GuiUpdateAllViews();
-        RefreshPatchList();
+      FlushFilter();
+      RemovePatchGroups(hwnd, g_Patches, "in the current list");
+      break;
 
-        sprintf(msg, "Batch removal complete.\n\nRestored: %d\nFailed: %d",
-                successCount, failCount);
-        MessageBoxA(hwnd, msg, "Remove All Result", MB_ICONINFORMATION);
+    case ID_MENU_REMOVE_MODULE: {
+      int iItem = GetFocusRow();
+      if (iItem == -1)
+        break;
+      // A module's groups are runs of the store (several for no module)
+      ModuleId module = g_AllPatches.Module(g_Patches[iItem]);
+      std::vector<IndexRange> ranges;
+      g_AllPatches.ModuleRanges(module, ranges);
+      PatchView indices;
+      for (const IndexRange &r : ranges) {
+        for (size_t i = r.begin; i < r.end; ++i)
+          indices.push_back((uint32_t)i);
       }
+      char scope[MAX_MODULE_SIZE + 16];
+      snprintf(scope, sizeof(scope), "in %s",
+               module != MODULE_NONE ? ModuleNameById(module)
+                                     : "no module");
+      RemovePatchGroups(hwnd, indices, scope);
       break;
     }
 
     case ID_MENU_DISASM:
     case ID_MENU_APPLY:
     case ID_MENU_RESTORE:
-    case ID_MENU_DELETE: {
-      int iItem = ListView_GetNextItem(hList, -1, LVNI_SELECTED);
-      if (iItem != -1)
-        ExecuteAction(hwnd, LOWORD(wParam), iItem);
+    case ID_MENU_DELETE:
+      ExecuteAction(hwnd, LOWORD(wParam));
       break;
     }
-    }
     break;
   }
   case WM_CLOSE:
     DestroyWindow(hwnd);
     break;
+  case WM_ACTIVATE:
+    // Breakpoints may have been edited in x64dbg meanwhile, which no
+    // plugin callback reports
+    if (LOWORD(wParam) != WA_INACTIVE && hList) {
+      InvalidateBreakpoints();
+      InvalidateRect(hList, NULL, FALSE);
+    }
+    break;
   case WM_DESTROY:
+    // Wait for the sync worker; it posts to this window
+    g_AutoRefreshWnd = NULL;
+    if (g_AutoRefreshTimer) {
+      KillTimer(hwnd, IDT_AUTOREFRESH);
+      g_AutoRefreshTimer = false;
+    }
+    ShutdownFilterWorker();
+    CancelPatchSync(g_AllPatches);
+    SavePatchCache();
+    g_HiddenPatches.clear();
     if (g_hBoldFont) {
       DeleteObject(g_hBoldFont);
       g_hBoldFont = NULL;
@@ -1053,7 +1266,10 @@ void OpenPatchWindow() {
   if (hPatchWindow) {
     ShowWindow(hPatchWindow, SW_SHOW);
     UpdateWindow(hPatchWindow);
+    g_LastAutoRefresh = GetTickCount();
     RefreshPatchList();
+    g_AutoRefreshPosted = false;
+    g_AutoRefreshWnd = hPatchWindow;
   }
 }
 
@@ -1127,6 +1343,14 @@ bool ImportAndApplyPatches(const char *filepath) {
     Log("[PatchMgr] Main Module Name: %s\n", mainModName);
   }
 
+  // Parsed "address:byte" lines, patched once the whole file is read
+  struct ImportByte {
+    duint addr;
+    unsigned char value;
+    int line;
+  };
+  std::vector<ImportByte> items;
+
   char buffer[512];
   int successCount = 0;
   int failCount = 0;
@@ -1172,51 +1396,78 @@ bool ImportAndApplyPatches(const char *filepath) {
     if (!validParse)
       continue;
 
-    bool patched = false;
-
-    // Attempt 1: Raw Address
-    if (dbgFuncs->MemPatch(addr, &newB, 1)) {
-      Log("[PatchMgr] Line %d: Patched via Raw Address (%p)\n", lineNum,
-          (void *)addr);
-      patched = true;
-    }
+    ImportByte item = {addr, newB, lineNum};
+    items.push_back(item);
+  }
+  fclose(fp);
 
-    // Attempt 2: RVA (ImageBase + Addr) - PRIORITY per User Request ("Default
-    // add ImageBase")
-    if (!patched && imageBase != 0) {
-      if (dbgFuncs->MemPatch(imageBase + addr, &newB, 1)) {
-        Log("[PatchMgr] Line %d: Patched via RVA (%p + %p -> %p)\n", lineNum,
-            (void *)imageBase, (void *)addr, (void *)(imageBase + addr));
-        patched = true;
+  // Each address interpretation gets one coalesced pass over the bytes
+  // still unpatched: consecutive addresses become one MemPatch
+  static const char *const modeNames[] = {"Raw Address", "RVA", "FileOffset"};
+  std::vector<size_t> pending(items.size());
+  for (size_t i = 0; i < pending.size(); ++i)
+    pending[i] = i;
+  for (int mode = 0; mode < 3 && !pending.empty(); ++mode) {
+    std::vector<PatchWrite> writes;
+    std::vector<size_t> source; // Index into items of each write
+    std::vector<size_t> next;
+    for (size_t i : pending) {
+      duint addr = items[i].addr;
+      duint va = 0;
+      if (mode == 0) {
+        // Attempt 1: Raw Address
+        va = addr;
+      } else if (mode == 1) {
+        // Attempt 2: RVA (ImageBase + Addr) - PRIORITY per User Request
+        // ("Default add ImageBase")
+        va = imageBase != 0 ? imageBase + addr : 0;
+      } else if (dbgFuncs->FileOffsetToVa && mainModName[0] != 0) {
+        // Attempt 3: File Offset -> VA (Fallback)
+        // Only used if RVA failed (e.g. address wasn't a valid RVA or memory
+        // not mapped there)
+        va = dbgFuncs->FileOffsetToVa(mainModName, addr);
+      }
+      if (va == 0) {
+        next.push_back(i);
+        continue;
       }
+      PatchWrite w = {va, &items[i].value, 1};
+      writes.push_back(w);
+      source.push_back(i);
     }
 
-    // Attempt 3: File Offset -> VA (Fallback)
-    // Only used if RVA failed (e.g. address wasn't a valid RVA or memory not
-    // mapped there)
-    if (!patched && dbgFuncs->FileOffsetToVa && mainModName[0] != 0) {
-      duint va = dbgFuncs->FileOffsetToVa(mainModName, addr);
-      if (va != 0 && dbgFuncs->MemPatch(va, &newB, 1)) {
-        Log("[PatchMgr] Line %d: Patched via FileOffset (%p -> %p)\n", lineNum,
-            (void *)addr, (void *)va);
-        patched = true;
+    if (!writes.empty()) {
+      std::vector<bool> ok;
+      PatchWriteStats stats = ApplyPatchWrites(writes, ok);
+      int patched = 0;
+      for (size_t k = 0; k < writes.size(); ++k) {
+        if (ok[k])
+          patched++;
+        else
+          next.push_back(source[k]);
       }
+      successCount += patched;
+      if (patched > 0)
+        Log("[PatchMgr] Patched %d bytes via %s in %d ranges\n", patched,
+            modeNames[mode], stats.ranges);
     }
+    std::sort(next.begin(), next.end());
+    pending.swap(next);
+  }
 
-    if (patched) {
-      successCount++;
-    } else {
-      duint vaAttempt = (dbgFuncs->FileOffsetToVa && mainModName[0])
-                            ? dbgFuncs->FileOffsetToVa(mainModName, addr)
-                            : 0;
-      Log("[PatchMgr] Line %d: FAILED %p. Tried Raw, RVA(%p), "
-          "OffsetToVa(%p)\n",
-          lineNum, (void *)addr, (void *)(imageBase + addr), (void *)vaAttempt);
-      failCount++;
-    }
+  for (size_t i : pending) {
+    duint addr = items[i].addr;
+    duint vaAttempt = (dbgFuncs->FileOffsetToVa && mainModName[0])
+                          ? dbgFuncs->FileOffsetToVa(mainModName, addr)
+                          : 0;
+    Log("[PatchMgr] Line %d: FAILED %p. Tried Raw, RVA(%p), "
+        "OffsetToVa(%p)\n",
+        items[i].line, (void *)addr, (void *)(imageBase + addr),
+        (void *)vaAttempt);
+    failCount++;
   }
-  fclose(fp);
 
+  InvalidateMemCache();
   GuiUpdateAllViews();
 
   char msg[256];
@@ -1235,13 +1486,14 @@ bool ExportPatches(const char *filepath) {
               "Address:OldByte->NewByte\n\n");
 
   // Use g_Patches which contains the currently visible/filtered patches
-  for (const auto &p : g_Patches) {
-    // Each PatchInfo is a contiguous block
-    for (size_t k = 0; k < p.oldBytes.size(); ++k) {
-      duint currentAddr = p.address + k;
-      unsigned char oldB = p.oldBytes[k];
-      unsigned char newB =
-          (k < p.newBytes.size()) ? p.newBytes[k] : 0; // Should match size
+  for (uint32_t index : g_Patches) {
+    // Each group is a contiguous block
+    const unsigned char *oldBytes = g_AllPatches.OldBytes(index);
+    const unsigned char *newBytes = g_AllPatches.NewBytes(index);
+    for (size_t k = 0; k < g_AllPatches.ByteCount(index); ++k) {
+      duint currentAddr = g_AllPatches.Address(index) + k;
+      unsigned char oldB = oldBytes[k];
+      unsigned char newB = newBytes[k];
       fprintf(fp, "%p:%02X->%02X\n", (void *)currentAddr, oldB, newB);
     }
   }
@@ -1,26 +1,28 @@
 #pragma once
+#include "PatchStore.h"
 #include "pluginsdk/_plugin_types.h" // For duint (if not using pluginmain.h to avoid full include)
 #include <string>
 #include <vector>
 
-// Standard Patch Structure
-struct PatchInfo {
-  duint address;
-  duint head; // Instruction start address
-  std::vector<unsigned char> oldBytes;
-  std::vector<unsigned char> newBytes;
-  std::string comment;   // User comment
-  std::string oldDisasm; // Disassembly BEFORE patch
-  std::string disasm;    // Disassembly AFTER patch
-  bool active;
-  std::string moduleName;
-};
-
 // Global Patch List
-extern std::vector<PatchInfo> g_Patches;
+extern PatchView g_Patches;     // Displayed (filtered), indices into g_AllPatches
+extern PatchStore g_AllPatches; // Everything from the debugger
 
 void OpenPatchWindow();
 void ClosePatchWindow();
-void RefreshPatchList();
+void RefreshPatchList(bool fullRebuild = false);
+
+// Default minimum time between two automatic refreshes
+#define AUTOREFRESH_DEFAULT_INTERVAL 500
+
+// Debugger events call this from any thread. The open window refreshes at
+// most once per interval; bursts collapse into one trailing refresh. Does
+// nothing while the window is closed or the interval is 0 (disabled).
+void RequestAutoRefresh();
+void SetAutoRefreshInterval(unsigned int ms);
+unsigned int GetAutoRefreshInterval();
 bool LoadPatchesFromFile(const char *filepath);
 void SavePatchesToFile(const char *filepath);
+
+void Log(const char *format, ...);
+std::string Utf8ToAnsi(const std::string &utf8);
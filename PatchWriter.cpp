@@ -0,0 +1,172 @@
+#include "PatchWriter.h"
+#include "pluginmain.h"
+#include <algorithm>
+#include <string.h>
+
+void CoalescePatchWrites(const std::vector<PatchWrite> &writes, size_t maxGap,
+                         PATCHGAPCHECK canBridge, std::vector<size_t> &order,
+                         std::vector<PatchRange> &ranges) {
+  order.resize(writes.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return writes[a].address < writes[b].address;
+  });
+
+  ranges.clear();
+  for (size_t k = 0; k < order.size(); ++k) {
+    const PatchWrite &w = writes[order[k]];
+    if (!ranges.empty()) {
+      PatchRange &r = ranges.back();
+      duint end = r.address + r.size;
+      bool join = w.address <= end;
+      if (!join && w.address - end <= maxGap)
+        join = !canBridge || canBridge(end, w.address);
+      if (join) {
+        if (w.address > end)
+          r.gaps = true;
+        if (w.address + w.size > end)
+          r.size = (size_t)(w.address + w.size - r.address);
+        r.count++;
+        continue;
+      }
+    }
+    PatchRange r = {w.address, w.size, k, 1, false};
+    ranges.push_back(r);
+  }
+
+  // Inside a range, bytes are laid down in submission order, so where
+  // writes overlap the one submitted last wins whatever its address
+  for (const PatchRange &r : ranges) {
+    if (r.count > 1)
+      std::sort(order.begin() + r.first, order.begin() + r.first + r.count);
+  }
+}
+
+// The range's bytes as they should end up: 'block' already holds the gap
+// bytes, later writes overwrite earlier ones
+static void MergeRange(const std::vector<PatchWrite> &writes,
+                       const std::vector<size_t> &order, const PatchRange &r,
+                       std::vector<unsigned char> &block) {
+  for (size_t k = r.first; k < r.first + r.count; ++k) {
+    const PatchWrite &w = writes[order[k]];
+    memcpy(block.data() + (w.address - r.address), w.bytes, w.size);
+  }
+}
+
+// Retry the writes of a failed range one at a time, skipping pages that
+// aren't mapped instead of calling MemPatch for every byte on them
+static void WriteOneByOne(const DBGFUNCTIONS *funcs,
+                          const std::vector<PatchWrite> &writes,
+                          const std::vector<size_t> &order,
+                          const PatchRange &r, std::vector<bool> &ok) {
+  duint lastPage = 0;
+  bool pageValid = false;
+  for (size_t k = r.first; k < r.first + r.count; ++k) {
+    const PatchWrite &w = writes[order[k]];
+    duint page = w.address & ~(duint)(PAGE_SIZE - 1);
+    if (k == r.first || page != lastPage) {
+      lastPage = page;
+      pageValid = DbgMemIsValidReadPtr(w.address);
+    }
+    ok[order[k]] = pageValid && funcs->MemPatch(w.address, w.bytes, w.size);
+  }
+}
+
+PatchWriteStats ApplyPatchWrites(const std::vector<PatchWrite> &writes,
+                                 std::vector<bool> &ok) {
+  PatchWriteStats stats = {0, 0};
+  ok.assign(writes.size(), false);
+  const DBGFUNCTIONS *funcs = DbgFunctions();
+  if (!funcs || !funcs->MemPatch)
+    return stats;
+
+  std::vector<size_t> order;
+  std::vector<PatchRange> ranges;
+  CoalescePatchWrites(writes, PATCH_COALESCE_GAP, NULL, order, ranges);
+
+  std::vector<unsigned char> block;
+  for (const PatchRange &r : ranges) {
+    if (r.size == 0) {
+      for (size_t k = r.first; k < r.first + r.count; ++k)
+        ok[order[k]] = true;
+      continue;
+    }
+    stats.ranges++;
+
+    // Gap bytes keep what memory holds now
+    block.resize(r.size);
+    bool filled = !r.gaps || DbgMemRead(r.address, block.data(), r.size);
+    if (filled) {
+      MergeRange(writes, order, r, block);
+      if (funcs->MemPatch(r.address, block.data(), r.size)) {
+        for (size_t k = r.first; k < r.first + r.count; ++k)
+          ok[order[k]] = true;
+        continue;
+      }
+    }
+    stats.rangesFailed++;
+    WriteOneByOne(funcs, writes, order, r, ok);
+  }
+  return stats;
+}
+
+// PatchInRange takes an inclusive end
+static bool NoPatchInGap(duint begin, duint end) {
+  const DBGFUNCTIONS *funcs = DbgFunctions();
+  return funcs && funcs->PatchInRange && !funcs->PatchInRange(begin, end - 1);
+}
+
+PatchWriteStats RestorePatchWrites(const std::vector<PatchWrite> &writes,
+                                   std::vector<bool> &ok) {
+  const DBGFUNCTIONS *funcs = DbgFunctions();
+  if (!funcs || !funcs->PatchRestoreRange)
+    return ApplyPatchWrites(writes, ok); // Write the old bytes back instead
+
+  PatchWriteStats stats = {0, 0};
+  ok.assign(writes.size(), false);
+  std::vector<size_t> order;
+  std::vector<PatchRange> ranges;
+  CoalescePatchWrites(writes, PATCH_COALESCE_GAP, NoPatchInGap, order,
+                      ranges);
+
+  std::vector<unsigned char> block, expected;
+  for (const PatchRange &r : ranges) {
+    if (r.size == 0) {
+      for (size_t k = r.first; k < r.first + r.count; ++k)
+        ok[order[k]] = true;
+      continue;
+    }
+    stats.ranges++;
+
+    // Inclusive end, like PatchInRange
+    funcs->PatchRestoreRange(r.address, r.address + r.size - 1);
+
+    // Compare against the merged bytes rather than each write's own, so an
+    // overlapped write isn't put back over the one that superseded it
+    block.resize(r.size);
+    expected.resize(r.size);
+    bool read = DbgMemRead(r.address, block.data(), r.size);
+    if (read)
+      memcpy(expected.data(), block.data(), r.size);
+    MergeRange(writes, order, r, expected);
+    bool rangeOk = true;
+    for (size_t k = r.first; k < r.first + r.count; ++k) {
+      const PatchWrite &w = writes[order[k]];
+      size_t offset = (size_t)(w.address - r.address);
+      bool restored =
+          read && memcmp(block.data() + offset, expected.data() + offset,
+                         w.size) == 0;
+      if (!restored && funcs->MemPatch) {
+        restored = funcs->MemPatch(w.address, expected.data() + offset, w.size);
+        if (restored)
+          memcpy(block.data() + offset, expected.data() + offset, w.size);
+      }
+      ok[order[k]] = restored;
+      rangeOk = rangeOk && restored;
+    }
+    if (!rangeOk)
+      stats.rangesFailed++;
+  }
+  return stats;
+}
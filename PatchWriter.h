@@ -0,0 +1,58 @@
+#pragma once
+#include "pluginsdk/_plugin_types.h"
+#include <stddef.h>
+#include <vector>
+
+// Largest run of untouched bytes between two writes that still joins them
+// into one range
+#define PATCH_COALESCE_GAP 16
+
+// Bytes to put at an address: the new bytes when applying, the original
+// ones when restoring. Points into caller memory.
+struct PatchWrite {
+  duint address;
+  const unsigned char *bytes;
+  size_t size;
+};
+
+// Writes order[first, first + count) as one block of 'size' bytes. Those
+// entries are in submission order.
+struct PatchRange {
+  duint address;
+  size_t size;
+  size_t first;
+  size_t count;
+  bool gaps; // Holds bytes no write covers
+};
+
+// Whether the gap [begin, end) may be covered by a range
+typedef bool (*PATCHGAPCHECK)(duint begin, duint end);
+
+// Sort 'writes' by address into 'order' and join writes that touch,
+// overlap or lie at most 'maxGap' bytes apart into ranges. 'canBridge', if
+// given, can veto joining across a gap. Each range's slice of 'order' is
+// then put back in submission order: laying the writes down in that order
+// makes the later of two overlapping writes win, whatever their starts.
+// Pure, no debugger calls.
+void CoalescePatchWrites(const std::vector<PatchWrite> &writes, size_t maxGap,
+                         PATCHGAPCHECK canBridge, std::vector<size_t> &order,
+                         std::vector<PatchRange> &ranges);
+
+struct PatchWriteStats {
+  int ranges;       // Ranges issued
+  int rangesFailed; // Ranges whose block call failed
+};
+
+// Write every entry with one MemPatch per range. Gap bytes are written back
+// with their current value, which x64dbg doesn't record as a patch. If a
+// range fails, its writes are retried one by one where memory is valid.
+// ok[i] tells whether writes[i] went in.
+PatchWriteStats ApplyPatchWrites(const std::vector<PatchWrite> &writes,
+                                 std::vector<bool> &ok);
+
+// Bring every entry back to its bytes with one PatchRestoreRange per range.
+// Ranges only bridge gaps that hold no patch, so nothing else is restored.
+// Memory is checked afterwards and writes that still differ (not patches
+// x64dbg knows of) go through MemPatch.
+PatchWriteStats RestorePatchWrites(const std::vector<PatchWrite> &writes,
+                                   std::vector<bool> &ok);
@@ -0,0 +1,328 @@
+#include "TextMatcher.h"
+#include <ctype.h>
+#include <string.h>
+#include <windows.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TEXTMATCHER_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static inline unsigned char FoldChar(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+#ifdef TEXTMATCHER_SSE2
+static inline unsigned int LowestBit(unsigned int mask) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (unsigned int)index;
+#else
+  return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Remaining bytes of a candidate position, first byte already matched
+static inline bool MatchRest(const char *text, const char *needle,
+                             size_t needleLen) {
+  for (size_t k = 1; k < needleLen; ++k) {
+    if (text[k] != needle[k])
+      return false;
+  }
+  return true;
+}
+
+bool ContainsText(const char *text, size_t textLen, const char *needle,
+                  size_t needleLen) {
+  if (needleLen == 0)
+    return true;
+  if (textLen < needleLen)
+    return false;
+
+  char first = needle[0];
+  size_t last = textLen - needleLen; // Last possible start
+  size_t i = 0;
+
+#ifdef TEXTMATCHER_SSE2
+  // Find the first byte 16 positions at a time
+  const __m128i vFirst = _mm_set1_epi8(first);
+  for (; i + 16 <= textLen && i <= last; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(text + i));
+    unsigned int mask =
+        (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, vFirst));
+    while (mask) {
+      size_t pos = i + LowestBit(mask);
+      if (pos > last)
+        return false;
+      if (MatchRest(text + pos, needle, needleLen))
+        return true;
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  for (; i <= last; ++i) {
+    if (text[i] == first && MatchRest(text + i, needle, needleLen))
+      return true;
+  }
+  return false;
+}
+
+void FoldAscii(char *text, size_t len) {
+  for (size_t i = 0; i < len; ++i)
+    text[i] = (char)FoldChar((unsigned char)text[i]);
+}
+
+void FoldAnsi(char *text, size_t len) {
+  FoldAscii(text, len);
+  size_t i = 0;
+  while (i < len && !(text[i] & 0x80))
+    ++i;
+  if (i == len)
+    return; // Plain ASCII
+
+  int wideLen = MultiByteToWideChar(CP_ACP, 0, text, (int)len, NULL, 0);
+  if (wideLen <= 0)
+    return;
+  std::vector<wchar_t> wide(wideLen);
+  MultiByteToWideChar(CP_ACP, 0, text, (int)len, wide.data(), wideLen);
+  CharLowerBuffW(wide.data(), (DWORD)wideLen);
+
+  // Only take the result if it fits the original bytes exactly
+  BOOL usedDefault = FALSE;
+  int ansiLen = WideCharToMultiByte(CP_ACP, 0, wide.data(), wideLen, NULL, 0,
+                                    NULL, &usedDefault);
+  if (ansiLen != (int)len || usedDefault)
+    return;
+  WideCharToMultiByte(CP_ACP, 0, wide.data(), wideLen, text, (int)len, NULL,
+                      NULL);
+}
+
+// Split a pattern without regex metacharacters into its '|' alternatives.
+// Returns false if any other metacharacter is present.
+static bool SplitLiterals(const char *pattern,
+                          std::vector<std::string> &literals) {
+  std::string current;
+  for (const char *p = pattern; *p; ++p) {
+    char c = *p;
+    if (c == '\\') {
+      // "\." etc. is a literal; "\d", "\b" and friends are regex classes
+      char next = p[1];
+      if (!next || (next >= '0' && next <= '9') ||
+          (next >= 'a' && next <= 'z') || (next >= 'A' && next <= 'Z'))
+        return false;
+      current.push_back((char)FoldChar((unsigned char)next));
+      ++p;
+    } else if (c == '|') {
+      literals.push_back(current);
+      current.clear();
+    } else if (strchr(".^$*+?()[]{}", c)) {
+      return false;
+    } else {
+      current.push_back((char)FoldChar((unsigned char)c));
+    }
+  }
+  literals.push_back(current);
+  return true;
+}
+
+bool TextMatcher::Compile(const char *pattern) {
+  m_literals.clear();
+  m_pattern = pattern ? pattern : "";
+  if (!pattern || !pattern[0]) {
+    m_kind = MATCH_ALL;
+    return true;
+  }
+
+  if (SplitLiterals(pattern, m_literals)) {
+    // An empty alternative matches anywhere, like it does in a regex
+    for (auto &lit : m_literals) {
+      if (lit.empty()) {
+        m_literals.clear();
+        m_kind = MATCH_ALL;
+        return true;
+      }
+      FoldAnsi(&lit[0], lit.size());
+    }
+    m_kind = MATCH_LITERALS;
+    return true;
+  }
+
+  m_literals.clear();
+  try {
+    // Fold everything but escape letters ("\D" is not "\d"). Named classes
+    // like [[:upper:]] mean something else on folded text; keep icase there.
+    if (m_pattern.find("[:") == std::string::npos) {
+      std::string folded = m_pattern;
+      FoldAnsi(&folded[0], folded.size());
+      for (size_t i = 0; i + 1 < folded.size(); ++i) {
+        if (m_pattern[i] == '\\') {
+          ++i;
+          folded[i] = m_pattern[i];
+        }
+      }
+      m_regex.assign(folded, std::regex::optimize);
+    } else {
+      m_regex.assign(pattern, std::regex::icase | std::regex::optimize);
+    }
+  } catch (...) {
+    m_kind = MATCH_ALL;
+    return false;
+  }
+  m_kind = MATCH_REGEX;
+  return true;
+}
+
+bool TextMatcher::Search(const char *folded) const {
+  switch (m_kind) {
+  case MATCH_ALL:
+    return true;
+  case MATCH_LITERALS: {
+    size_t len = strlen(folded);
+    for (const auto &lit : m_literals) {
+      if (ContainsText(folded, len, lit.data(), lit.size()))
+        return true;
+    }
+    return false;
+  }
+  case MATCH_REGEX:
+    return std::regex_search(folded, m_regex);
+  }
+  return false;
+}
+
+bool TextMatcher::Refines(const TextMatcher &broader) const {
+  if (broader.m_kind == MATCH_ALL)
+    return true;
+  if (m_kind == MATCH_REGEX || broader.m_kind == MATCH_REGEX)
+    return m_kind == broader.m_kind && m_pattern == broader.m_pattern;
+  if (m_kind == MATCH_ALL)
+    return false;
+  // Each of our alternatives must contain one of the broader ones
+  for (const auto &lit : m_literals) {
+    bool covered = false;
+    for (const auto &b : broader.m_literals) {
+      if (lit.find(b) != std::string::npos) {
+        covered = true;
+        break;
+      }
+    }
+    if (!covered)
+      return false;
+  }
+  return true;
+}
+
+// Index of the ']' or ')' closing the class or group opened at 'open', or
+// the pattern length if it is unterminated (ECMAScript rules: ']' always
+// closes a class)
+static size_t SkipBracket(const std::string &re, size_t open) {
+  size_t depth = 0;
+  for (size_t i = open; i < re.size(); ++i) {
+    char c = re[i];
+    if (c == '\\') {
+      ++i;
+    } else if (re[open] == '[') {
+      if (c == ']')
+        return i;
+    } else if (c == '[') {
+      i = SkipBracket(re, i);
+    } else if (c == '(') {
+      ++depth;
+    } else if (c == ')' && --depth == 0) {
+      return i;
+    }
+  }
+  return re.size();
+}
+
+// Plain runs of one regex alternative (no top-level '|')
+static bool RegexRuns(const std::string &re, std::vector<std::string> &runs) {
+  std::string current;
+  auto flush = [&]() {
+    if (current.size() >= 3)
+      runs.push_back(current);
+    current.clear();
+  };
+
+  for (size_t i = 0; i < re.size(); ++i) {
+    char c = re[i];
+    if (c == '\\') {
+      char next = i + 1 < re.size() ? re[i + 1] : 0;
+      if (next && strchr("dDsSwWbB", next)) {
+        flush(); // Class or assertion
+        ++i;
+      } else if (next && !isalnum((unsigned char)next)) {
+        current.push_back(next); // Escaped punctuation
+        ++i;
+      } else {
+        return false; // \x41, \n, backreferences: not worth decoding
+      }
+    } else if (c == '(' || c == '[') {
+      flush();
+      i = SkipBracket(re, i);
+    } else if (c == '*' || c == '?') {
+      if (!current.empty())
+        current.pop_back(); // The last atom may be absent
+      flush();
+    } else if (c == '{') {
+      if (!current.empty())
+        current.pop_back();
+      flush();
+      while (i < re.size() && re[i] != '}')
+        ++i;
+    } else if (strchr(".^$+)]}", c) || (unsigned char)c >= 0x80) {
+      flush(); // '+' keeps its atom, but the run can't continue across it
+    } else {
+      current.push_back((char)FoldChar((unsigned char)c));
+    }
+  }
+  flush();
+  return true;
+}
+
+bool TextMatcher::RequiredLiterals(
+    std::vector<std::vector<std::string>> &anyOf) const {
+  anyOf.clear();
+  if (m_kind == MATCH_LITERALS) {
+    for (const auto &lit : m_literals)
+      anyOf.push_back(std::vector<std::string>(1, lit));
+  } else if (m_kind == MATCH_REGEX) {
+    // Split at top-level '|'
+    size_t start = 0;
+    for (size_t i = 0;; ++i) {
+      if (i < m_pattern.size()) {
+        char c = m_pattern[i];
+        if (c == '\\')
+          ++i;
+        else if (c == '(' || c == '[')
+          i = SkipBracket(m_pattern, i);
+        if (c != '|')
+          continue;
+      }
+      std::vector<std::string> runs;
+      if (!RegexRuns(m_pattern.substr(start, i - start), runs))
+        return false;
+      anyOf.push_back(runs);
+      if (i >= m_pattern.size())
+        break;
+      start = i + 1;
+    }
+  }
+
+  for (const auto &all : anyOf) {
+    bool useful = false;
+    for (const auto &s : all)
+      useful |= s.size() >= 3;
+    if (!useful) {
+      anyOf.clear();
+      return false;
+    }
+  }
+  return !anyOf.empty();
+}
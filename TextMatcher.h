@@ -0,0 +1,57 @@
+#pragma once
+#include <regex>
+#include <string>
+#include <vector>
+
+// Case-insensitive "does the text contain the pattern" test used by the
+// filter boxes. Compile() classifies the pattern once:
+//   - empty                   -> matches everything
+//   - plain text / a|b|c      -> literal search (SSE2 first-byte scan)
+//   - anything else           -> std::regex (regex_search semantics)
+// Backslash-escaped punctuation such as "\." or "\[" still counts as plain
+// text. The pattern is case-folded once at compile time and Search() takes
+// text that was folded the same way (the store's search shadows), so
+// matching is a plain byte comparison.
+class TextMatcher {
+public:
+  enum Kind { MATCH_ALL, MATCH_LITERALS, MATCH_REGEX };
+
+  // Returns false if the pattern is not a valid regex
+  bool Compile(const char *pattern);
+
+  // 'folded' must be folded with FoldAnsi (or FoldAscii for ASCII text)
+  bool Search(const char *folded) const;
+
+  Kind GetKind() const { return m_kind; }
+  const std::string &GetPattern() const { return m_pattern; }
+
+  // True if every text this matcher accepts is also accepted by 'broader'
+  // (e.g. "call" refines "cal", "jmp|jne" refines "j"). Conservative: false
+  // when it can't tell.
+  bool Refines(const TextMatcher &broader) const;
+
+  // Lower-case strings a match must contain, for index lookups: one entry
+  // per alternative, each listing strings that must all appear. Regexes
+  // only yield the plain runs outside groups, classes and optional atoms.
+  // Returns false if nothing is required (MATCH_ALL, or an alternative
+  // without any plain run).
+  bool RequiredLiterals(std::vector<std::vector<std::string>> &anyOf) const;
+
+private:
+  Kind m_kind = MATCH_ALL;
+  std::string m_pattern;
+  std::vector<std::string> m_literals; // Folded
+  std::regex m_regex; // Folded pattern, or icase when it can't be folded
+};
+
+// Substring search (SSE2 first-byte scan)
+bool ContainsText(const char *text, size_t textLen, const char *needle,
+                  size_t needleLen);
+
+// Case folding shared by the search shadows and the patterns. FoldAscii
+// lowers ASCII letters. FoldAnsi also lowers the other letters of the ANSI
+// code page (comments) through the system's Unicode tables, as long as
+// that keeps the byte length, so folded text lines up byte for byte with
+// the original.
+void FoldAscii(char *text, size_t len);
+void FoldAnsi(char *text, size_t len);
@@ -0,0 +1,124 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define THREADPOOL_MAX_THREADS 32
+
+struct ParallelJob {
+  const std::function<void(size_t, size_t)> *fn;
+  size_t count;
+  size_t grain;
+  std::atomic<size_t> next{0};
+  size_t active = 0; // Workers inside RunBlocks, guarded by g_PoolLock
+};
+
+static std::mutex g_PoolLock; // Guards everything below
+static std::condition_variable g_PoolWake;
+static std::condition_variable g_PoolIdle;
+static std::vector<std::thread> g_PoolThreads;
+static ParallelJob *g_PoolJob = NULL;
+static unsigned int g_PoolGeneration = 0;
+static bool g_PoolStop = false;
+
+static std::mutex g_PoolBusy; // One loop at a time
+
+static void RunBlocks(ParallelJob *job) {
+  while (true) {
+    size_t begin = job->next.fetch_add(job->grain);
+    if (begin >= job->count)
+      break;
+    size_t end = begin + job->grain;
+    if (end > job->count)
+      end = job->count;
+    (*job->fn)(begin, end);
+  }
+}
+
+static void PoolWorker() {
+  unsigned int seen = 0;
+  std::unique_lock<std::mutex> lock(g_PoolLock);
+  while (true) {
+    g_PoolWake.wait(
+        lock, [&] { return g_PoolStop || g_PoolGeneration != seen; });
+    if (g_PoolStop)
+      return;
+    seen = g_PoolGeneration;
+    ParallelJob *job = g_PoolJob;
+    if (!job)
+      continue; // Woke up after the loop already finished
+
+    job->active++;
+    lock.unlock();
+    RunBlocks(job);
+    lock.lock();
+    if (--job->active == 0)
+      g_PoolIdle.notify_all();
+  }
+}
+
+// Caller holds g_PoolLock
+static void StartPoolThreads() {
+  if (!g_PoolThreads.empty() || g_PoolStop)
+    return;
+  size_t n = std::thread::hardware_concurrency();
+  if (n > THREADPOOL_MAX_THREADS)
+    n = THREADPOOL_MAX_THREADS;
+  for (size_t i = 1; i < n; ++i)
+    g_PoolThreads.emplace_back(PoolWorker);
+}
+
+void ParallelFor(size_t count, size_t grain,
+                 const std::function<void(size_t, size_t)> &fn) {
+  if (count == 0)
+    return;
+  if (grain == 0)
+    grain = 1;
+
+  std::unique_lock<std::mutex> busy(g_PoolBusy, std::try_to_lock);
+  if (!busy.owns_lock() || count <= grain) {
+    for (size_t begin = 0; begin < count; begin += grain)
+      fn(begin, begin + grain < count ? begin + grain : count);
+    return;
+  }
+
+  ParallelJob job;
+  job.fn = &fn;
+  job.count = count;
+  job.grain = grain;
+  {
+    std::lock_guard<std::mutex> lock(g_PoolLock);
+    StartPoolThreads();
+    g_PoolJob = &job;
+    g_PoolGeneration++;
+  }
+  g_PoolWake.notify_all();
+
+  RunBlocks(&job);
+
+  // No worker can pick the job up once it is unpublished under the lock
+  std::unique_lock<std::mutex> lock(g_PoolLock);
+  g_PoolIdle.wait(lock, [&] { return job.active == 0; });
+  g_PoolJob = NULL;
+}
+
+size_t ThreadPoolSize() {
+  size_t n = std::thread::hardware_concurrency();
+  if (n > THREADPOOL_MAX_THREADS)
+    n = THREADPOOL_MAX_THREADS;
+  return n ? n : 1;
+}
+
+void ShutdownThreadPool() {
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(g_PoolLock);
+    g_PoolStop = true;
+    threads.swap(g_PoolThreads);
+  }
+  g_PoolWake.notify_all();
+  for (auto &t : threads)
+    t.join();
+}
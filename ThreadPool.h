@@ -0,0 +1,18 @@
+#pragma once
+#include <functional>
+#include <stddef.h>
+
+// Small pool of worker threads for data-parallel loops.
+// fn(begin, end) is called for consecutive blocks of at most 'grain' items
+// out of [0, count). Blocks are handed out dynamically so uneven work
+// balances itself. The calling thread takes part and the call returns once
+// every block is done. If the pool is already running another loop, the
+// blocks run on the calling thread instead of waiting.
+void ParallelFor(size_t count, size_t grain,
+                 const std::function<void(size_t, size_t)> &fn);
+
+// Threads a ParallelFor can use, including the caller
+size_t ThreadPoolSize();
+
+// Join the workers (plugin unload)
+void ShutdownThreadPool();
@@ -0,0 +1,183 @@
+#include "TrigramIndex.h"
+#include <algorithm>
+#include <iterator>
+
+// Once the next list is this many times longer than the rows still in the
+// running, intersecting it costs more than checking those rows directly
+#define TRIGRAM_INTERSECT_RATIO 16
+
+static inline uint32_t FoldByte(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') ? (uint32_t)(c + ('a' - 'A')) : c;
+}
+
+static inline uint32_t MakeKey(const unsigned char *p, int field) {
+  return ((FoldByte(p[0]) << 16 | FoldByte(p[1]) << 8 | FoldByte(p[2])) << 2) |
+         (uint32_t)field;
+}
+
+static void PutVarint(std::vector<uint8_t> &out, uint32_t v) {
+  while (v >= 0x80) {
+    out.push_back((uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((uint8_t)v);
+}
+
+static const uint8_t *GetVarint(const uint8_t *p, uint32_t &v) {
+  v = 0;
+  int shift = 0;
+  uint8_t b;
+  do {
+    b = *p++;
+    v |= (uint32_t)(b & 0x7F) << shift;
+    shift += 7;
+  } while (b & 0x80);
+  return p;
+}
+
+void TrigramIndex::AddText(uint32_t row, int field, const char *text) {
+  const unsigned char *p = (const unsigned char *)text;
+  if (!p[0] || !p[1])
+    return;
+  for (; p[2]; ++p) {
+    Posting &posting = m_postings[MakeKey(p, field)];
+    if (posting.count && posting.last == row)
+      continue; // Already listed for this row
+    PutVarint(posting.deltas, posting.count ? row - posting.last : row);
+    posting.last = row;
+    posting.count++;
+  }
+}
+
+void TrigramIndex::Add(uint32_t row, const char *oldDisasm,
+                       const char *comment, const char *disasm) {
+  AddText(row, FIELD_OLD, oldDisasm);
+  AddText(row, FIELD_OLD, comment);
+  AddText(row, FIELD_NEW, disasm);
+}
+
+void TrigramIndex::Append(const TrigramIndex &other, uint32_t rowBase) {
+  for (const auto &kv : other.m_postings) {
+    const Posting &src = kv.second;
+    if (!src.count)
+      continue;
+    Posting &dst = m_postings[kv.first];
+    // Only the first delta is relative to the other index's row 0
+    uint32_t first;
+    const uint8_t *rest = GetVarint(src.deltas.data(), first);
+    first += rowBase;
+    PutVarint(dst.deltas, dst.count ? first - dst.last : first);
+    dst.deltas.insert(dst.deltas.end(), rest,
+                      src.deltas.data() + src.deltas.size());
+    dst.last = rowBase + src.last;
+    dst.count += src.count;
+  }
+}
+
+void TrigramIndex::clear() { m_postings.clear(); }
+
+void TrigramIndex::swap(TrigramIndex &other) {
+  m_postings.swap(other.m_postings);
+}
+
+void TrigramIndex::Decode(uint32_t key, std::vector<uint32_t> &rows) const {
+  rows.clear();
+  auto it = m_postings.find(key);
+  if (it == m_postings.end())
+    return;
+  const Posting &posting = it->second;
+  rows.reserve(posting.count);
+  const uint8_t *p = posting.deltas.data();
+  const uint8_t *end = p + posting.deltas.size();
+  uint32_t row = 0;
+  while (p < end) {
+    uint32_t delta;
+    p = GetVarint(p, delta);
+    row += delta;
+    rows.push_back(row);
+  }
+}
+
+uint32_t TrigramIndex::Count(uint32_t key) const {
+  auto it = m_postings.find(key);
+  return it != m_postings.end() ? it->second.count : 0;
+}
+
+bool TrigramIndex::Lookup(int fields,
+                          const std::vector<std::vector<std::string>> &anyOf,
+                          std::vector<uint32_t> &rows) const {
+  rows.clear();
+  if (anyOf.empty())
+    return false;
+
+  std::vector<uint32_t> alt, list, part, merged;
+  for (const auto &all : anyOf) {
+    // Trigrams (without the field bits) this alternative requires
+    std::vector<uint32_t> trigrams;
+    for (const auto &s : all) {
+      const unsigned char *p = (const unsigned char *)s.c_str();
+      for (size_t k = 0; k + 3 <= s.size(); ++k)
+        trigrams.push_back(MakeKey(p + k, 0));
+    }
+    if (trigrams.empty())
+      return false;
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+                   trigrams.end());
+
+    auto count = [&](uint32_t t) {
+      return ((fields & FIELD_OLD) ? Count(t | FIELD_OLD) : 0) +
+             ((fields & FIELD_NEW) ? Count(t | FIELD_NEW) : 0);
+    };
+    auto decode = [&](uint32_t t, std::vector<uint32_t> &out) {
+      out.clear();
+      if (fields & FIELD_OLD)
+        Decode(t | FIELD_OLD, out);
+      if (fields & FIELD_NEW) {
+        Decode(t | FIELD_NEW, part);
+        if (out.empty()) {
+          out.swap(part);
+        } else {
+          merged.clear();
+          std::set_union(out.begin(), out.end(), part.begin(), part.end(),
+                         std::back_inserter(merged));
+          out.swap(merged);
+        }
+      }
+    };
+
+    // Rarest first, so the running intersection shrinks quickly
+    std::sort(trigrams.begin(), trigrams.end(),
+              [&](uint32_t a, uint32_t b) { return count(a) < count(b); });
+    decode(trigrams[0], alt);
+    for (size_t k = 1; k < trigrams.size() && !alt.empty(); ++k) {
+      if (count(trigrams[k]) > TRIGRAM_INTERSECT_RATIO * alt.size())
+        break; // The matcher will check the remaining rows anyway
+      decode(trigrams[k], list);
+      merged.clear();
+      std::set_intersection(alt.begin(), alt.end(), list.begin(), list.end(),
+                            std::back_inserter(merged));
+      alt.swap(merged);
+    }
+
+    if (rows.empty()) {
+      rows.swap(alt);
+    } else {
+      merged.clear();
+      std::set_union(rows.begin(), rows.end(), alt.begin(), alt.end(),
+                     std::back_inserter(merged));
+      rows.swap(merged);
+    }
+  }
+  return true;
+}
+
+size_t TrigramIndex::MemoryUsage() const {
+  // Map nodes: key, posting and roughly two pointers of allocator overhead
+  size_t usage = m_postings.bucket_count() * sizeof(void *) +
+                 m_postings.size() *
+                     (sizeof(uint32_t) + sizeof(Posting) + 2 * sizeof(void *));
+  for (const auto &kv : m_postings)
+    usage += kv.second.deltas.capacity();
+  return usage;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Trigram posting lists over the text columns of a PatchStore. Every run of
+// three (ASCII case-folded) bytes in a row's text maps to the sorted list of
+// rows containing it, so a search for "getproc" only has to look at rows
+// that contain "get", "etp", "tpr", "pro" and "roc". Rows are added in
+// order and never removed, like the store itself. Lists are delta encoded
+// as varints, which keeps the common short gaps at one byte.
+class TrigramIndex {
+public:
+  // Columns a lookup can be restricted to
+  enum Field {
+    FIELD_OLD = 1, // Old disassembly and comment
+    FIELD_NEW = 2, // New disassembly
+  };
+
+  // Takes the store's folded search shadows
+  void Add(uint32_t row, const char *oldDisasm, const char *comment,
+           const char *disasm);
+  // Append every list of 'other', whose row 0 becomes 'rowBase'
+  void Append(const TrigramIndex &other, uint32_t rowBase);
+  void clear();
+  void swap(TrigramIndex &other);
+
+  // Candidate rows for a text that must contain, for at least one entry of
+  // 'anyOf', every string in that entry (lower case). Rows are sorted.
+  // Returns false if the index can't narrow the search, i.e. some entry has
+  // no string of three or more bytes.
+  bool Lookup(int fields, const std::vector<std::vector<std::string>> &anyOf,
+              std::vector<uint32_t> &rows) const;
+
+  size_t MemoryUsage() const;
+
+private:
+  struct Posting {
+    uint32_t last;  // Last row added
+    uint32_t count; // Rows in the list
+    std::vector<uint8_t> deltas;
+  };
+
+  void AddText(uint32_t row, int field, const char *text);
+  void Decode(uint32_t key, std::vector<uint32_t> &rows) const;
+  uint32_t Count(uint32_t key) const;
+
+  // Key: trigram << 2 | field
+  std::unordered_map<uint32_t, Posting> m_postings;
+};
@@ -0,0 +1,149 @@
+// Keystroke latency of the filter box on a large patch list: an icase
+// std::regex built on every keystroke and regex_search over the old
+// disassembly, comment and new disassembly of every group, copying the
+// matches (ApplyFilter before), against PatchFilter::Compile plus one
+// FilterCache::Apply shared across keystrokes. Each script types a pattern
+// into the "Old" box one character at a time, then takes some back.
+//
+//   bench_filter [groups]      default: 100000
+#include "PatchFilter.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <regex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Script {
+  const char *pattern;
+  size_t backspaces;
+};
+
+static const Script g_Scripts[] = {
+    {"getprocaddress", 7},
+    {"call dword ptr", 5},
+    {"mov.*ecx", 3},
+};
+
+static std::vector<PatchInfo> MakeGroups(size_t count) {
+  static const char *const disasm[] = {
+      "call eax",
+      "jmp 0x401000",
+      "jne short 0x140001234",
+      "mov eax, dword ptr ds:[ecx+0x10]",
+      "push ebp",
+      "call dword ptr ds:[<&GetProcAddress>]",
+      "xor eax, eax",
+      "nop",
+      "lea rcx, qword ptr ss:[rsp+0x20]",
+      "ret"};
+  static const char *const comments[] = {"", "", "", "GetProcAddress hook",
+                                         "\"Game Over\"", "skip intro"};
+  std::mt19937 rng(6);
+  std::vector<PatchInfo> groups(count);
+  for (size_t i = 0; i < count; ++i) {
+    PatchInfo &p = groups[i];
+    p.address = 0x140001000 + i * 8;
+    p.head = p.address;
+    p.oldBytes.assign(1 + rng() % 4, 0x90);
+    p.newBytes.assign(p.oldBytes.size(), 0xCC);
+    p.oldDisasm = disasm[rng() % 10];
+    p.disasm = disasm[rng() % 10];
+    p.comment = comments[rng() % 6];
+  }
+  return groups;
+}
+
+// Every text the box holds while the script runs
+static std::vector<std::string> Keystrokes(const Script &script) {
+  std::vector<std::string> texts;
+  std::string text = script.pattern;
+  for (size_t n = 1; n <= text.size(); ++n)
+    texts.push_back(text.substr(0, n));
+  for (size_t k = 1; k <= script.backspaces; ++k)
+    texts.push_back(text.substr(0, text.size() - k));
+  return texts;
+}
+
+// ApplyFilter before, for the "Old" box only
+static size_t BaselineFilter(const std::vector<PatchInfo> &all,
+                             const std::string &fOld,
+                             std::vector<PatchInfo> &shown) {
+  try {
+    std::regex reOld(fOld, std::regex::icase);
+    std::regex reNew(".*", std::regex::icase);
+    shown.clear();
+    for (const auto &p : all) {
+      bool matchOld = std::regex_search(p.oldDisasm, reOld) ||
+                      std::regex_search(p.comment, reOld);
+      bool matchNew = std::regex_search(p.disasm, reNew);
+      if (matchOld && matchNew)
+        shown.push_back(p);
+    }
+  } catch (...) {
+    shown = all;
+  }
+  return shown.size();
+}
+
+static size_t NewFilter(const PatchStore &store, FilterCache &cache,
+                        const std::string &fOld, PatchView &view) {
+  PatchFilter filter;
+  if (!filter.Compile(fOld.c_str(), false, "", false))
+    return store.size(); // The window shows every group
+  cache.Apply(store, filter, view);
+  return view.size();
+}
+
+struct Timing {
+  double total = 0;
+  double worst = 0;
+  void Add(Clock::time_point start) {
+    double ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+    total += ms;
+    worst = std::max(worst, ms);
+  }
+};
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? (size_t)atol(argv[1]) : 100000;
+  std::vector<PatchInfo> groups = MakeGroups(count);
+  PatchStore store;
+  for (const PatchInfo &p : groups)
+    store.Append(p);
+  printf("%zu groups, %zu pool threads\n", count, ThreadPoolSize());
+
+  for (const Script &script : g_Scripts) {
+    std::vector<std::string> texts = Keystrokes(script);
+    std::vector<PatchInfo> shown;
+    PatchView view;
+    FilterCache cache;
+    Timing before, after;
+    size_t mismatches = 0;
+    for (const std::string &text : texts) {
+      Clock::time_point start = Clock::now();
+      size_t want = BaselineFilter(groups, text, shown);
+      before.Add(start);
+      start = Clock::now();
+      size_t got = NewFilter(store, cache, text, view);
+      after.Add(start);
+      mismatches += got != want;
+    }
+    printf("'%s' + %zu backspaces (%zu keystrokes)\n", script.pattern,
+           script.backspaces, texts.size());
+    printf("  %-22s %9.2f ms/key  %9.2f ms worst\n", "std::regex per key",
+           before.total / texts.size(), before.worst);
+    printf("  %-22s %9.2f ms/key  %9.2f ms worst%s\n", "PatchFilter + cache",
+           after.total / texts.size(), after.worst,
+           mismatches ? "  RESULTS DIFFER" : "");
+  }
+  ShutdownThreadPool();
+  return 0;
+}
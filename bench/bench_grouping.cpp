@@ -0,0 +1,122 @@
+// Turning PatchEnum's byte list into groups: std::sort over whole
+// DBGPATCHINFO records plus strcmp grouping into per-group module strings
+// (what SyncPatchesFromDebugger did before) against GroupPatches, at 10k,
+// 100k and 1M patched bytes, for a list in address order (what x64dbg
+// usually returns) and a shuffled one.
+//
+//   bench_grouping [bytes ...]      default: 10000 100000 1000000
+#include "PatchSync.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define REPEAT 3
+
+typedef std::chrono::steady_clock Clock;
+
+// The group record before the module table
+struct BaselineGroup {
+  duint address;
+  std::string moduleName;
+  std::vector<unsigned char> oldBytes;
+  std::vector<unsigned char> newBytes;
+};
+
+static std::vector<BaselineGroup>
+BaselineGroupPatches(std::vector<DBGPATCHINFO> &dbgPatches) {
+  std::sort(dbgPatches.begin(), dbgPatches.end(),
+            [](const DBGPATCHINFO &a, const DBGPATCHINFO &b) {
+              return a.addr < b.addr;
+            });
+  std::vector<BaselineGroup> groups;
+  if (dbgPatches.empty())
+    return groups;
+  BaselineGroup current;
+  current.address = dbgPatches[0].addr;
+  current.moduleName = dbgPatches[0].mod;
+  current.oldBytes.push_back(dbgPatches[0].oldbyte);
+  current.newBytes.push_back(dbgPatches[0].newbyte);
+  for (size_t i = 1; i < dbgPatches.size(); ++i) {
+    const DBGPATCHINFO &dp = dbgPatches[i];
+    if (strcmp(dp.mod, current.moduleName.c_str()) == 0 &&
+        dp.addr == current.address + current.oldBytes.size()) {
+      current.oldBytes.push_back(dp.oldbyte);
+      current.newBytes.push_back(dp.newbyte);
+    } else {
+      groups.push_back(current);
+      current.address = dp.addr;
+      current.moduleName = dp.mod;
+      current.oldBytes.assign(1, dp.oldbyte);
+      current.newBytes.assign(1, dp.newbyte);
+    }
+  }
+  groups.push_back(current);
+  return groups;
+}
+
+// Runs of 1-8 bytes spread over four modules, in address order
+static std::vector<DBGPATCHINFO> MakePatches(size_t count) {
+  static const char *const modules[] = {"game.exe", "engine.dll",
+                                        "physics.dll", "ntdll.dll"};
+  std::mt19937 rng(4);
+  std::vector<DBGPATCHINFO> patches(count);
+  duint addr = 0x140001000;
+  size_t run = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (run == 0) {
+      addr += 1 + rng() % 64;
+      run = 1 + rng() % 8;
+    }
+    DBGPATCHINFO &p = patches[i];
+    memset(p.mod, 0, sizeof(p.mod));
+    strcpy(p.mod, modules[i * 4 / count]);
+    p.addr = addr++;
+    p.oldbyte = (unsigned char)rng();
+    p.newbyte = (unsigned char)~p.oldbyte;
+    --run;
+  }
+  return patches;
+}
+
+int main(int argc, char **argv) {
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i)
+    sizes.push_back((size_t)atol(argv[i]));
+  if (sizes.empty())
+    sizes = {10000, 100000, 1000000};
+
+  for (size_t count : sizes) {
+    std::vector<DBGPATCHINFO> sorted = MakePatches(count);
+    std::vector<DBGPATCHINFO> shuffled = sorted;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(5));
+
+    for (int order = 0; order < 2; ++order) {
+      const std::vector<DBGPATCHINFO> &input = order ? shuffled : sorted;
+      double before = 0, after = 0;
+      size_t groupsBefore = 0, groupsAfter = 0;
+      for (int r = 0; r < REPEAT; ++r) {
+        std::vector<DBGPATCHINFO> copy = input; // Baseline sorts in place
+        Clock::time_point start = Clock::now();
+        groupsBefore = BaselineGroupPatches(copy).size();
+        Clock::time_point middle = Clock::now();
+        groupsAfter = GroupPatches(input).size();
+        Clock::time_point end = Clock::now();
+        before += std::chrono::duration<double, std::milli>(middle - start)
+                      .count();
+        after += std::chrono::duration<double, std::milli>(end - middle)
+                     .count();
+      }
+      printf("%8zu bytes %-8s  struct sort + strcmp %8.2f ms  GroupPatches "
+             "%8.2f ms  (%zu groups%s)\n",
+             count, order ? "shuffled" : "sorted", before / REPEAT,
+             after / REPEAT, groupsAfter,
+             groupsBefore == groupsAfter ? "" : ", GROUP COUNT DIFFERS");
+    }
+  }
+  return 0;
+}
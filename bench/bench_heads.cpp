@@ -0,0 +1,113 @@
+// Instruction-head resolution: the dis.prev/dis.len DbgEval chain
+// (FindCorrectOldHead, what every group went through before) against
+// HeadResolver, over the simulated debugger. DbgEval round trips can be
+// given a latency, since that is where the real chain spends its time. The
+// simulated debugger has no source lines, so the chain's first step
+// (GetSourceFromAddr) costs nothing here.
+//
+//   bench_heads [latency_us ...]      default: 0 20
+#include "HeadResolver.h"
+#include "MemCache.h"
+#include "SimDebugger.h"
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define MODULE_BASE 0x140000000ull
+#define HEAP_BASE 0x2A0000ull
+#define REPEAT 3
+
+typedef std::chrono::steady_clock Clock;
+
+static double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// One group every 16-40 bytes of the module, 1-3 bytes long
+static std::vector<PatchInfo> MakeGroups() {
+  std::mt19937 rng(2);
+  std::vector<PatchInfo> groups;
+  duint end = MODULE_BASE + SIM_MODULE_SIZE - 64;
+  for (duint addr = MODULE_BASE + 64; addr < end; addr += 16 + rng() % 25) {
+    PatchInfo p = {};
+    p.address = addr;
+    p.head = addr;
+    p.module = InternModule(SIM_MODULE_NAME);
+    p.oldBytes.resize(1 + rng() % 3);
+    DbgMemRead(addr, p.oldBytes.data(), p.oldBytes.size());
+    for (size_t k = 0; k < p.oldBytes.size(); ++k) {
+      unsigned char value = (unsigned char)(p.oldBytes[k] ^ (1 + rng() % 255));
+      p.newBytes.push_back(value);
+      SimPatch(addr + k, value);
+    }
+    groups.push_back(p);
+  }
+  return groups;
+}
+
+// What the debugger says the head is, uncounted
+static std::vector<duint> TrueHeads(const std::vector<PatchInfo> &groups) {
+  std::vector<duint> heads;
+  char expr[64];
+  for (const PatchInfo &p : groups) {
+    snprintf(expr, sizeof(expr), "dis.prev(0x%llX + 1)",
+             (unsigned long long)p.address);
+    heads.push_back(DbgEval(expr, NULL));
+  }
+  return heads;
+}
+
+static void Report(const char *name, double seconds, size_t resolutions,
+                   size_t evals, size_t correct) {
+  printf("  %-16s %10.0f resolutions/s  %5.2f DbgEval each  %5.1f%% "
+         "correct\n",
+         name, resolutions / seconds, (double)evals / resolutions,
+         100.0 * correct / resolutions);
+}
+
+int main(int argc, char **argv) {
+  std::vector<unsigned int> latencies;
+  for (int i = 1; i < argc; ++i)
+    latencies.push_back((unsigned int)atoi(argv[i]));
+  if (latencies.empty())
+    latencies = {0, 20};
+
+  SimReset(1, MODULE_BASE, HEAP_BASE);
+  std::vector<PatchInfo> groups = MakeGroups();
+  std::vector<duint> truth = TrueHeads(groups);
+  PatchStore noPrevious;
+
+  for (unsigned int latency : latencies) {
+    printf("%zu groups, DbgEval latency %u us\n", groups.size(), latency);
+    SimSetEvalLatency(latency);
+
+    size_t evals = SimEvalCalls(), correct = 0;
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < REPEAT; ++r) {
+      InvalidateMemCache();
+      for (size_t i = 0; i < groups.size(); ++i)
+        correct += FindCorrectOldHead(groups[i].address) == truth[i];
+    }
+    Report("dis.prev chain", SecondsSince(start), REPEAT * groups.size(),
+           SimEvalCalls() - evals, correct);
+
+    evals = SimEvalCalls();
+    correct = 0;
+    HeadResolver::Stats stats = {0, 0, 0};
+    start = Clock::now();
+    for (int r = 0; r < REPEAT; ++r) {
+      InvalidateMemCache();
+      HeadResolver resolver(noPrevious); // Cold: no heads from a last sync
+      for (size_t i = 0; i < groups.size(); ++i)
+        correct += resolver.Resolve(groups, i) == truth[i];
+      stats = resolver.GetStats();
+    }
+    Report("HeadResolver", SecondsSince(start), REPEAT * groups.size(),
+           SimEvalCalls() - evals, correct);
+    printf("  %-16s %zu local, %zu traced, %zu debugger per pass\n", "",
+           stats.local, stats.traced, stats.debugger);
+  }
+  return 0;
+}
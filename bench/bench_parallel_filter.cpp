@@ -0,0 +1,90 @@
+// One full filter pass, serial (PatchFilter::Matches over every group, the
+// pass before the thread pool) against FilterCache::Apply with a fresh
+// cache, which filters chunks on the pool. The patterns are inverted, which
+// gives the trigram index nothing to look up, so both sides evaluate every
+// group and the difference is the pool alone. Speedup can't exceed the
+// number of pool threads printed first; on a single core the two should be
+// even.
+//
+//   bench_parallel_filter [groups]      default: 500000
+#include "PatchFilter.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define REPEAT 3
+
+typedef std::chrono::steady_clock Clock;
+
+static const char *const g_Patterns[] = {"call", "dword ptr", "mov.*ecx",
+                                         "get(proc|module)"};
+
+static void FillStore(PatchStore &store, size_t count) {
+  static const char *const disasm[] = {
+      "call eax",
+      "jmp 0x401000",
+      "jne short 0x140001234",
+      "mov eax, dword ptr ds:[ecx+0x10]",
+      "push ebp",
+      "call dword ptr ds:[<&GetProcAddress>]",
+      "call dword ptr ds:[<&GetModuleHandleA>]",
+      "lea rcx, qword ptr ss:[rsp+0x20]"};
+  static const char *const comments[] = {"", "", "", "GetProcAddress hook",
+                                         "skip intro"};
+  std::mt19937 rng(7);
+  for (size_t i = 0; i < count; ++i) {
+    PatchInfo p = {};
+    p.address = 0x140001000 + i * 8;
+    p.head = p.address;
+    p.oldBytes.assign(1 + rng() % 4, 0x90);
+    p.newBytes.assign(p.oldBytes.size(), 0xCC);
+    p.oldDisasm = disasm[rng() % 8];
+    p.disasm = disasm[rng() % 8];
+    p.comment = comments[rng() % 5];
+    store.Append(p);
+  }
+}
+
+static double MillisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? (size_t)atol(argv[1]) : 500000;
+  PatchStore store;
+  FillStore(store, count);
+  size_t threads = ThreadPoolSize();
+  printf("%zu groups, %zu pool threads\n", count, threads);
+
+  for (const char *pattern : g_Patterns) {
+    PatchFilter filter;
+    filter.Compile(pattern, true, "", false);
+
+    double serial = 0, parallel = 0;
+    size_t serialRows = 0;
+    PatchView view;
+    for (int r = 0; r < REPEAT; ++r) {
+      Clock::time_point start = Clock::now();
+      serialRows = 0;
+      for (size_t i = 0; i < store.size(); ++i)
+        serialRows += filter.Matches(store, i);
+      serial += MillisecondsSince(start);
+
+      FilterCache cache; // Nothing to narrow from: a full pass every time
+      start = Clock::now();
+      cache.Apply(store, filter, view);
+      parallel += MillisecondsSince(start);
+    }
+    double speedup = serial / parallel;
+    printf("!%-16s %7zu rows  serial %8.2f ms  pool %8.2f ms  %5.2fx  "
+           "%5.1f%% efficiency%s\n",
+           pattern, view.size(), serial / REPEAT, parallel / REPEAT, speedup,
+           100.0 * speedup / threads,
+           serialRows == view.size() ? "" : "  RESULTS DIFFER");
+  }
+  ShutdownThreadPool();
+  return 0;
+}
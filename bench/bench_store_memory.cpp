@@ -0,0 +1,151 @@
+// Heap bytes per group: the list as std::vector<PatchInfo> with its own
+// vectors and strings (g_AllPatches before), plus the copy of every visible
+// group the filtered list held, against PatchStore and an index view. Heap
+// use is measured by counting every operator new, so vector slack, string
+// buffers and the store's folded text and trigram index are all included.
+// PatchStore::MemoryUsage (the figure the sync log prints) is shown too.
+//
+//   bench_store_memory [groups]      default: 100000
+#include "PatchStore.h"
+#include <atomic>
+#include <new>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// Room in front of every block for its size, keeping 16-byte alignment
+#define HEADER_SIZE 16
+
+static std::atomic<size_t> g_LiveBytes{0};
+
+void *operator new(size_t size) {
+  char *block = (char *)malloc(size + HEADER_SIZE);
+  if (!block)
+    throw std::bad_alloc();
+  *(size_t *)block = size;
+  g_LiveBytes += size;
+  return block + HEADER_SIZE;
+}
+
+void operator delete(void *p) noexcept {
+  if (!p)
+    return;
+  char *block = (char *)p - HEADER_SIZE;
+  g_LiveBytes -= *(size_t *)block;
+  free(block);
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+// The group record before the store
+struct BaselinePatchInfo {
+  duint address;
+  duint head;
+  std::vector<unsigned char> oldBytes;
+  std::vector<unsigned char> newBytes;
+  std::string comment;
+  std::string oldDisasm;
+  std::string disasm;
+  bool active;
+  std::string moduleName;
+};
+
+// Groups of 1-8 bytes with typical x64dbg disassembly text (operands with
+// addresses, so most of it is longer than a short-string buffer), a comment
+// on one group in four and a handful of modules
+static std::vector<PatchInfo> MakeGroups(size_t count) {
+  static const char *const modules[] = {"game.exe", "kernelbase.dll",
+                                        "d3d11_graphics_engine.dll",
+                                        "anticheat_client64.dll"};
+  static const char *const mnemonics[] = {
+      "call 0x%llX", "jmp 0x%llX", "jne short 0x%llX",
+      "mov eax, dword ptr ds:[0x%llX]", "lea rcx, qword ptr ds:[0x%llX]"};
+  static const char *const comments[] = {"skip intro", "infinite ammo",
+                                         "GetProcAddress hook",
+                                         "no cd check"};
+  std::mt19937 rng(8);
+  std::vector<PatchInfo> groups(count);
+  char text[96];
+  for (size_t i = 0; i < count; ++i) {
+    PatchInfo &p = groups[i];
+    p.address = 0x140001000 + i * 24;
+    p.head = p.address;
+    size_t size = 1 + rng() % 8;
+    for (size_t k = 0; k < size; ++k) {
+      p.oldBytes.push_back((unsigned char)rng());
+      p.newBytes.push_back((unsigned char)rng());
+    }
+    unsigned long long target = 0x140000000 + rng() % 0x1000000;
+    snprintf(text, sizeof(text), mnemonics[rng() % 5], target);
+    p.oldDisasm = text;
+    snprintf(text, sizeof(text), mnemonics[rng() % 5], target + 0x10);
+    p.disasm = text;
+    if (rng() % 4 == 0)
+      p.comment = comments[rng() % 4];
+    p.active = true;
+    p.module = InternModule(modules[i * 4 / count]);
+  }
+  return groups;
+}
+
+static void Report(const char *name, size_t bytes, size_t count) {
+  printf("  %-34s %10zu bytes  %7.1f bytes/group\n", name, bytes,
+         (double)bytes / count);
+}
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? (size_t)atol(argv[1]) : 100000;
+  std::vector<PatchInfo> groups = MakeGroups(count);
+  printf("%zu groups\n", count);
+
+  // Before: built by push_back like the sync did, then copied whole into
+  // the filtered list while no filter is set
+  size_t start = g_LiveBytes;
+  std::vector<BaselinePatchInfo> all;
+  for (const PatchInfo &p : groups) {
+    BaselinePatchInfo b;
+    b.address = p.address;
+    b.head = p.head;
+    b.oldBytes = p.oldBytes;
+    b.newBytes = p.newBytes;
+    b.comment = p.comment;
+    b.oldDisasm = p.oldDisasm;
+    b.disasm = p.disasm;
+    b.active = p.active;
+    b.moduleName = ModuleNameById(p.module);
+    all.push_back(b);
+  }
+  size_t list = g_LiveBytes - start;
+  std::vector<BaselinePatchInfo> shown = all;
+  size_t listAndShown = g_LiveBytes - start;
+
+  // After: appended one group at a time like a sync block, then an index
+  // view of every group
+  start = g_LiveBytes;
+  PatchStore store;
+  for (const PatchInfo &p : groups)
+    store.Append(p);
+  size_t storeBytes = g_LiveBytes - start;
+  PatchView view;
+  for (size_t i = 0; i < store.size(); ++i)
+    view.push_back((uint32_t)i);
+  size_t storeAndView = g_LiveBytes - start;
+
+  printf("before (std::vector<PatchInfo>, %zu bytes per record)\n",
+         sizeof(BaselinePatchInfo));
+  Report("list", list, count);
+  Report("list + unfiltered copy", listAndShown, count);
+  printf("after (PatchStore)\n");
+  Report("store", storeBytes, count);
+  Report("store + unfiltered view", storeAndView, count);
+  Report("MemoryUsage() (no folded/trigrams)", store.MemoryUsage(), count);
+  Report("Trigrams().MemoryUsage()", store.Trigrams().MemoryUsage(), count);
+  printf("  %.1fx less with the filtered list, %.1fx for the list alone\n",
+         (double)listAndShown / storeAndView, (double)list / storeBytes);
+  return 0;
+}
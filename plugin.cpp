@@ -1,12 +1,17 @@
 #include "plugin.h"
+#include "Breakpoints.h"
+#include "MemCache.h"
+#include "PatchCache.h"
+#include "PatchWindow.h"
+#include "ThreadPool.h"
 #include "icon_data.h" // Generated header
 #include "pluginmain.h"
+#include <stdlib.h>
 
 enum { MENU_PATCHES, MENU_PATCHES_CTX };
 
-// Forward declaration
-void OpenPatchWindow();
-void ClosePatchWindow();
+#define SETTINGS_SECTION "PatchKing"
+#define SETTING_AUTOREFRESH "AutoRefreshInterval"
 
 extern "C" PLUG_EXPORT void CBMENUENTRY(CBTYPE cbType,
                                         PLUG_CB_MENUENTRY *info) {
@@ -21,7 +26,61 @@ extern "C" PLUG_EXPORT void CBMENUENTRY(CBTYPE cbType,
   }
 }
 
-bool pluginInit(PLUG_INITSTRUCT *initStruct) { return true; }
+// Debuggee memory may have changed; cached pages are stale
+static void cbMemoryChanged(CBTYPE cbType, void *callbackInfo) {
+  InvalidateMemCache();
+}
+
+// The patch list may have changed as well (new code, unloaded modules,
+// session ended); let an open window pick it up
+static void cbPatchesChanged(CBTYPE cbType, void *callbackInfo) {
+  InvalidateMemCache();
+  InvalidateBreakpoints();
+  RequestAutoRefresh();
+}
+
+// A hit may have removed a one-shot breakpoint
+static void cbBreakpoint(CBTYPE cbType, void *callbackInfo) {
+  InvalidateBreakpoints();
+}
+
+// PatchKingRefresh: for scripts, after commands that patch memory
+static bool cbRefreshCommand(int argc, char **argv) {
+  InvalidateMemCache();
+  InvalidateBreakpoints();
+  RequestAutoRefresh();
+  return true;
+}
+
+// PatchKingAutoRefresh [ms]: show or set the auto-refresh interval, 0 = off
+static bool cbAutoRefreshCommand(int argc, char **argv) {
+  if (argc > 1) {
+    unsigned int ms = (unsigned int)strtoul(argv[1], NULL, 0);
+    SetAutoRefreshInterval(ms);
+    BridgeSettingSetUint(SETTINGS_SECTION, SETTING_AUTOREFRESH, ms);
+  }
+  Log("[PatchMgr] Auto-refresh interval: %u ms%s\n", GetAutoRefreshInterval(),
+      GetAutoRefreshInterval() ? "" : " (disabled)");
+  return true;
+}
+
+bool pluginInit(PLUG_INITSTRUCT *initStruct) {
+  duint interval = AUTOREFRESH_DEFAULT_INTERVAL;
+  if (BridgeSettingGetUint(SETTINGS_SECTION, SETTING_AUTOREFRESH, &interval))
+    SetAutoRefreshInterval((unsigned int)interval);
+
+  _plugin_registercallback(pluginHandle, CB_PAUSEDEBUG, cbPatchesChanged);
+  _plugin_registercallback(pluginHandle, CB_STEPPED, cbMemoryChanged);
+  _plugin_registercallback(pluginHandle, CB_LOADDLL, cbPatchesChanged);
+  _plugin_registercallback(pluginHandle, CB_UNLOADDLL, cbPatchesChanged);
+  _plugin_registercallback(pluginHandle, CB_STOPDEBUG, cbPatchesChanged);
+  _plugin_registercallback(pluginHandle, CB_BREAKPOINT, cbBreakpoint);
+  _plugin_registercommand(pluginHandle, "PatchKingRefresh", cbRefreshCommand,
+                          false);
+  _plugin_registercommand(pluginHandle, "PatchKingAutoRefresh",
+                          cbAutoRefreshCommand, false);
+  return true;
+}
 
 void pluginSetup() {
   // Main Menu
@@ -49,6 +108,16 @@ void pluginSetup() {
 }
 
 bool pluginStop() {
+  _plugin_unregistercallback(pluginHandle, CB_PAUSEDEBUG);
+  _plugin_unregistercallback(pluginHandle, CB_STEPPED);
+  _plugin_unregistercallback(pluginHandle, CB_LOADDLL);
+  _plugin_unregistercallback(pluginHandle, CB_UNLOADDLL);
+  _plugin_unregistercallback(pluginHandle, CB_STOPDEBUG);
+  _plugin_unregistercallback(pluginHandle, CB_BREAKPOINT);
+  _plugin_unregistercommand(pluginHandle, "PatchKingRefresh");
+  _plugin_unregistercommand(pluginHandle, "PatchKingAutoRefresh");
   ClosePatchWindow();
+  SavePatchCache();
+  ShutdownThreadPool();
   return true;
 }
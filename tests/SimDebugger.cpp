@@ -0,0 +1,330 @@
+#include "SimDebugger.h"
+#include "PatchCache.h"
+#include "PatchWindow.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct SimRegion {
+  duint base;
+  std::vector<unsigned char> memory;
+  std::vector<unsigned char> original;
+  std::vector<bool> heads; // Instruction starts in the original code
+  const char *module;      // "" outside a module
+};
+
+static SimRegion g_Regions[2];
+static std::map<duint, std::string> g_Comments;
+static unsigned int g_EnumCalls = 0;
+static unsigned int g_EvalLatency = 0;
+static std::atomic<size_t> g_EvalCalls{0};
+static std::atomic<size_t> g_DisasmCalls{0};
+
+static std::mutex g_LogLock;
+static std::string g_LastLog;
+
+static std::mutex g_CacheLock;
+static std::map<std::string, PatchCacheEntry> g_Cache;
+
+static int InstructionLength(unsigned char first) { return 1 + first % 4; }
+
+static SimRegion *FindRegion(duint addr) {
+  for (SimRegion &r : g_Regions) {
+    if (addr >= r.base && addr - r.base < r.memory.size())
+      return &r;
+  }
+  return NULL;
+}
+
+static void FillCode(SimRegion &r, std::mt19937 &rng) {
+  size_t size = r.memory.size();
+  r.heads.assign(size, false);
+  for (size_t function = 0; function < size; function += SIM_FUNCTION_SIZE) {
+    size_t end = function + SIM_FUNCTION_SIZE;
+    size_t pos = function;
+    while (end - pos >= 4) {
+      unsigned char first = (unsigned char)rng();
+      r.heads[pos] = true;
+      r.memory[pos] = first;
+      for (int k = 1; k < InstructionLength(first); ++k)
+        r.memory[pos + k] = (unsigned char)rng();
+      pos += InstructionLength(first);
+    }
+    for (; pos < end; ++pos) {
+      r.heads[pos] = true;
+      r.memory[pos] = 0x90; // op90, one byte
+    }
+  }
+  r.original = r.memory;
+}
+
+void SimReset(unsigned int seed, duint moduleBase, duint heapBase) {
+  std::mt19937 rng(seed);
+  g_Regions[0].base = moduleBase;
+  g_Regions[0].memory.resize(SIM_MODULE_SIZE);
+  g_Regions[0].module = SIM_MODULE_NAME;
+  g_Regions[1].base = heapBase;
+  g_Regions[1].memory.resize(SIM_HEAP_SIZE);
+  g_Regions[1].module = "";
+  for (SimRegion &r : g_Regions)
+    FillCode(r, rng);
+  g_Comments.clear();
+  g_EnumCalls = 0;
+}
+
+duint SimModuleBase() { return g_Regions[0].base; }
+duint SimHeapBase() { return g_Regions[1].base; }
+
+void SimPatch(duint addr, unsigned char value) {
+  SimRegion *r = FindRegion(addr);
+  if (r)
+    r->memory[(size_t)(addr - r->base)] = value;
+}
+
+void SimRestore(duint addr) {
+  SimRegion *r = FindRegion(addr);
+  if (r)
+    r->memory[(size_t)(addr - r->base)] = r->original[(size_t)(addr - r->base)];
+}
+
+size_t SimPatchCount() {
+  size_t count = 0;
+  for (const SimRegion &r : g_Regions) {
+    for (size_t k = 0; k < r.memory.size(); ++k)
+      count += r.memory[k] != r.original[k];
+  }
+  return count;
+}
+
+void SimSetComment(duint addr, const char *text) { g_Comments[addr] = text; }
+
+void SimSetEvalLatency(unsigned int microseconds) {
+  g_EvalLatency = microseconds;
+}
+
+size_t SimEvalCalls() { return g_EvalCalls; }
+
+size_t SimDisasmCalls() { return g_DisasmCalls; }
+
+std::string SimLastLog() {
+  std::lock_guard<std::mutex> guard(g_LogLock);
+  return g_LastLog;
+}
+
+size_t SimCacheSize() {
+  std::lock_guard<std::mutex> guard(g_CacheLock);
+  return g_Cache.size();
+}
+
+// --- DBGFUNCTIONS ---
+
+static duint SimModBaseFromAddr(duint addr) {
+  SimRegion *r = FindRegion(addr);
+  return r && r->module[0] ? r->base : 0;
+}
+
+static bool SimPatchEnum(DBGPATCHINFO *list, size_t *size) {
+  std::vector<DBGPATCHINFO> patches;
+  for (const SimRegion &r : g_Regions) {
+    for (size_t k = 0; k < r.memory.size(); ++k) {
+      if (r.memory[k] == r.original[k])
+        continue;
+      DBGPATCHINFO p;
+      memset(&p, 0, sizeof(p));
+      strncpy(p.mod, r.module, sizeof(p.mod) - 1);
+      p.addr = r.base + k;
+      p.oldbyte = r.original[k];
+      p.newbyte = r.memory[k];
+      patches.push_back(p);
+    }
+  }
+  if (!list) {
+    *size = patches.size() * sizeof(DBGPATCHINFO);
+    return true;
+  }
+  if (*size < patches.size() * sizeof(DBGPATCHINFO))
+    return false;
+  // Every other listing comes out of order, which x64dbg doesn't promise
+  // against
+  if (++g_EnumCalls % 2 == 0)
+    std::shuffle(patches.begin(), patches.end(), std::mt19937(g_EnumCalls));
+  memcpy(list, patches.data(), patches.size() * sizeof(DBGPATCHINFO));
+  return true;
+}
+
+static bool SimDisasmFast(const unsigned char *data, duint addr,
+                          BASIC_INSTRUCTION_INFO *info) {
+  ++g_DisasmCalls;
+  memset(info, 0, sizeof(*info));
+  info->size = InstructionLength(data[0]);
+  if (data[0] < 0x40 && info->size >= 2) {
+    duint target = addr + info->size + (duint)(int64_t)(int8_t)data[1];
+    info->type = TYPE_ADDR;
+    info->addr = target;
+    info->branch = true;
+    snprintf(info->instruction, sizeof(info->instruction), "jmp 0x%llX",
+             (unsigned long long)target);
+  } else {
+    snprintf(info->instruction, sizeof(info->instruction), "op%02X", data[0]);
+  }
+  return true;
+}
+
+static bool SimMemPatch(duint va, const unsigned char *src, duint size) {
+  for (duint k = 0; k < size; ++k) {
+    if (!FindRegion(va + k))
+      return false;
+  }
+  for (duint k = 0; k < size; ++k)
+    SimPatch(va + k, src[k]);
+  return true;
+}
+
+static void SimPatchRestoreRange(duint start, duint end) {
+  for (duint addr = start; addr <= end; ++addr)
+    SimRestore(addr);
+}
+
+static bool SimPatchInRange(duint start, duint end) {
+  for (duint addr = start; addr <= end; ++addr) {
+    SimRegion *r = FindRegion(addr);
+    size_t k = r ? (size_t)(addr - r->base) : 0;
+    if (r && r->memory[k] != r->original[k])
+      return true;
+  }
+  return false;
+}
+
+static DBGFUNCTIONS MakeFunctions() {
+  DBGFUNCTIONS funcs;
+  memset(&funcs, 0, sizeof(funcs));
+  funcs.ModBaseFromAddr = SimModBaseFromAddr;
+  funcs.PatchEnum = SimPatchEnum;
+  funcs.DisasmFast = SimDisasmFast;
+  funcs.MemPatch = SimMemPatch;
+  funcs.PatchRestoreRange = SimPatchRestoreRange;
+  funcs.PatchInRange = SimPatchInRange;
+  return funcs;
+}
+
+static const DBGFUNCTIONS g_Functions = MakeFunctions();
+
+const DBGFUNCTIONS *DbgFunctions() { return &g_Functions; }
+
+// --- Bridge exports ---
+
+bool DbgMemRead(duint va, void *dest, duint size) {
+  SimRegion *r = FindRegion(va);
+  if (!r || size > r->memory.size() - (size_t)(va - r->base))
+    return false;
+  memcpy(dest, r->memory.data() + (size_t)(va - r->base), (size_t)size);
+  return true;
+}
+
+bool DbgMemIsValidReadPtr(duint addr) { return FindRegion(addr) != NULL; }
+
+bool DbgIsRunning() { return false; }
+
+bool DbgFunctionGet(duint addr, duint *start, duint *end) {
+  SimRegion *r = FindRegion(addr);
+  if (!r)
+    return false;
+  *start = r->base + (addr - r->base) / SIM_FUNCTION_SIZE * SIM_FUNCTION_SIZE;
+  *end = *start + SIM_FUNCTION_SIZE - 1;
+  return true;
+}
+
+bool DbgGetLabelAt(duint addr, SEGMENTREG, char *text) {
+  SimRegion *r = FindRegion(addr);
+  if (!r || !r->module[0] || (addr - r->base) % SIM_FUNCTION_SIZE != 0)
+    return false;
+  snprintf(text, MAX_LABEL_SIZE, "fn%u",
+           (unsigned int)((addr - r->base) / SIM_FUNCTION_SIZE));
+  return true;
+}
+
+bool DbgGetCommentAt(duint addr, char *text) {
+  auto it = g_Comments.find(addr);
+  if (it == g_Comments.end())
+    return false;
+  snprintf(text, MAX_COMMENT_SIZE, "%s", it->second.c_str());
+  return true;
+}
+
+bool DbgGetStringAt(duint, char *) { return false; }
+
+// The debugger's view of the original code, for the fallback chain
+duint DbgEval(const char *expression, bool *success) {
+  ++g_EvalCalls;
+  auto until = std::chrono::steady_clock::now() +
+               std::chrono::microseconds(g_EvalLatency);
+  while (g_EvalLatency && std::chrono::steady_clock::now() < until) {
+  }
+
+  unsigned long long addr = 0;
+  bool ok = false;
+  duint value = 0;
+  if (sscanf(expression, "dis.prev(0x%llX + 1)", &addr) == 1) {
+    SimRegion *r = FindRegion((duint)addr);
+    if (r) {
+      size_t k = (size_t)(addr - r->base);
+      while (!r->heads[k])
+        --k;
+      value = r->base + k;
+      ok = true;
+    }
+  } else if (sscanf(expression, "dis.len(0x%llX)", &addr) == 1) {
+    SimRegion *r = FindRegion((duint)addr);
+    if (r) {
+      value = InstructionLength(r->original[(size_t)(addr - r->base)]);
+      ok = true;
+    }
+  }
+  if (success)
+    *success = ok;
+  return value;
+}
+
+// --- Plugin functions outside the modules under test ---
+
+void Log(const char *format, ...) {
+  char line[1024];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  std::lock_guard<std::mutex> guard(g_LogLock);
+  g_LastLog = line;
+}
+
+std::string Utf8ToAnsi(const std::string &utf8) { return utf8; }
+
+static std::string CacheKey(const PatchCacheKey &key) {
+  char suffix[64];
+  snprintf(suffix, sizeof(suffix), ":%llx:%llx", (unsigned long long)key.rva,
+           (unsigned long long)key.hash);
+  return key.module + suffix;
+}
+
+bool PatchCacheLookup(const PatchCacheKey &key, PatchCacheEntry &entry) {
+  std::lock_guard<std::mutex> guard(g_CacheLock);
+  auto it = g_Cache.find(CacheKey(key));
+  if (it == g_Cache.end())
+    return false;
+  entry = it->second;
+  return true;
+}
+
+void PatchCacheStore(const PatchCacheKey &key, const PatchCacheEntry &entry) {
+  std::lock_guard<std::mutex> guard(g_CacheLock);
+  g_Cache[CacheKey(key)] = entry;
+}
+
+void SavePatchCache() {}
@@ -0,0 +1,52 @@
+#pragma once
+#include "pluginmain.h"
+#include <stddef.h>
+#include <string>
+
+// Stand-in for the x64dbg bridge so the sync, head resolution and patch
+// writing code can run headless. The debuggee has two regions:
+//   - a module image ("game.dll"), named in PatchEnum and ModBaseFromAddr
+//   - a private heap region, which belongs to no module
+// Both hold code of a toy instruction set that DisasmFast decodes:
+//   length is 1 + (first byte % 4)
+//   a first byte below 0x40 with length >= 2 is "jmp 0x<target>", target
+//   relative to the next instruction, like a short jump
+//   anything else is "op<XX>"
+// Code is laid out in functions of SIM_FUNCTION_SIZE bytes (DbgFunctionGet),
+// and every function start has a label. Patches are tracked per byte like
+// x64dbg does: the original value is kept until the byte is written back.
+// Not thread-safe against writes; reads may come from the sync worker.
+
+#define SIM_MODULE_NAME "game.dll"
+#define SIM_MODULE_SIZE 0x10000
+#define SIM_HEAP_SIZE 0x4000
+#define SIM_FUNCTION_SIZE 0x200
+
+// Build both regions from 'seed' (same seed, same code) at the given bases
+// and drop every patch and comment
+void SimReset(unsigned int seed, duint moduleBase, duint heapBase);
+
+duint SimModuleBase();
+duint SimHeapBase();
+
+// Change one byte, as MemPatch would
+void SimPatch(duint addr, unsigned char value);
+// Put one byte back to its original value
+void SimRestore(duint addr);
+size_t SimPatchCount();
+
+// User comment at 'addr' (DbgGetCommentAt)
+void SimSetComment(duint addr, const char *text);
+
+// Busy-wait this long in every DbgEval, to stand in for the round trip
+// through x64dbg's expression parser
+void SimSetEvalLatency(unsigned int microseconds);
+size_t SimEvalCalls();
+size_t SimDisasmCalls();
+
+// Last line written with Log
+std::string SimLastLog();
+
+// Entries in the in-memory PatchCache that stands in for PatchKing.cache.
+// It survives SimReset, like the file survives a restart.
+size_t SimCacheSize();
@@ -0,0 +1,58 @@
+#include <windows.h>
+#include <errno.h>
+#include <strings.h>
+#include <wchar.h>
+#include <wctype.h>
+
+int _set_errno(int value) {
+  errno = value;
+  return 0;
+}
+
+int _strnicmp(const char *a, const char *b, size_t count) {
+  return strncasecmp(a, b, count);
+}
+
+// Nothing listens; tests poll instead of pumping messages
+BOOL PostMessage(HWND, UINT, WPARAM, LPARAM) { return TRUE; }
+
+int MultiByteToWideChar(UINT codePage, DWORD, LPCSTR text, int size,
+                        LPWSTR wide, int wideSize) {
+  if (size < 0)
+    size = (int)strlen(text) + 1;
+  if (!wide)
+    return size;
+  if (codePage == CP_UTF8 || size > wideSize)
+    return 0; // Not needed by the modules under test
+  for (int i = 0; i < size; ++i)
+    wide[i] = (unsigned char)text[i];
+  return size;
+}
+
+int WideCharToMultiByte(UINT codePage, DWORD, LPCWSTR wide, int size,
+                        LPSTR text, int textSize, LPCSTR, BOOL *usedDefault) {
+  if (size < 0)
+    size = (int)wcslen(wide) + 1;
+  if (usedDefault)
+    *usedDefault = FALSE;
+  if (!text)
+    return size;
+  if (codePage == CP_UTF8 || size > textSize)
+    return 0;
+  for (int i = 0; i < size; ++i) {
+    if (wide[i] > 0xFF) {
+      text[i] = '?';
+      if (usedDefault)
+        *usedDefault = TRUE;
+    } else {
+      text[i] = (char)wide[i];
+    }
+  }
+  return size;
+}
+
+DWORD CharLowerBuffW(LPWSTR text, DWORD size) {
+  for (DWORD i = 0; i < size; ++i)
+    text[i] = (WCHAR)towlower(text[i]);
+  return size;
+}
@@ -0,0 +1,73 @@
+#pragma once
+// The slice of <windows.h> the portable modules and the plugin SDK headers
+// use, so they build on other platforms. Functions are in compat.cpp.
+#ifdef _MSC_VER
+#error Use the real windows.h with MSVC
+#endif
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define __declspec(x)
+#define __cdecl
+#define __stdcall
+#define WINAPI
+#define CALLBACK
+#define DECLSPEC_ALIGN(x)
+
+typedef unsigned char BYTE, UCHAR, BOOLEAN, *PBYTE;
+typedef unsigned short WORD;
+typedef uint32_t DWORD, ULONG;
+typedef int32_t LONG;
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef uint64_t ULONGLONG, DWORD64, ULONG64, ULONG_PTR, DWORD_PTR, UINT_PTR,
+    SIZE_T, WPARAM;
+typedef int64_t LONGLONG, LONG_PTR, INT_PTR, LPARAM, LRESULT;
+typedef void *HANDLE, *LPVOID, *PVOID, *HWND, *HINSTANCE, *HMODULE, *HICON,
+    *HMENU;
+typedef char CHAR, *LPSTR;
+typedef const char *LPCSTR;
+typedef wchar_t WCHAR, *LPWSTR;
+typedef const wchar_t *LPCWSTR;
+typedef DWORD COLORREF;
+
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+#define CP_ACP 0
+#define CP_UTF8 65001
+#define WM_APP 0x8000
+
+// Only referenced by the SDK structures below; dbghelp.h is skipped
+#define _DBGHELP_
+typedef struct { DWORD64 Low; LONGLONG High; } M128A;
+typedef struct {
+  PVOID BaseAddress;
+  PVOID AllocationBase;
+  DWORD AllocationProtect;
+  SIZE_T RegionSize;
+  DWORD State;
+  DWORD Protect;
+  DWORD Type;
+} MEMORY_BASIC_INFORMATION;
+typedef struct { LONG x, y; } POINT;
+typedef struct { LONG left, top, right, bottom; } RECT;
+typedef struct { DWORD dwLowDateTime, dwHighDateTime; } FILETIME;
+typedef struct { int unused; } EXCEPTION_DEBUG_INFO, CREATE_PROCESS_DEBUG_INFO,
+    EXIT_PROCESS_DEBUG_INFO, CREATE_THREAD_DEBUG_INFO, EXIT_THREAD_DEBUG_INFO,
+    LOAD_DLL_DEBUG_INFO, UNLOAD_DLL_DEBUG_INFO, OUTPUT_DEBUG_STRING_INFO,
+    DEBUG_EVENT, PROCESS_INFORMATION, IMAGEHLP_MODULE64, MSG;
+
+inline void __debugbreak() {}
+int _set_errno(int value);
+int _strnicmp(const char *a, const char *b, size_t count);
+BOOL PostMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+// Code page conversions treat the ANSI code page as Latin-1
+int MultiByteToWideChar(UINT codePage, DWORD flags, LPCSTR text, int size,
+                        LPWSTR wide, int wideSize);
+int WideCharToMultiByte(UINT codePage, DWORD flags, LPCWSTR wide, int size,
+                        LPSTR text, int textSize, LPCSTR defaultChar,
+                        BOOL *usedDefault);
+DWORD CharLowerBuffW(LPWSTR text, DWORD size);
@@ -0,0 +1,150 @@
+// PatchRowCache and the cell formatters against the stringstream
+// formatting the list used before it went owner-data, plus the LRU's
+// capacity, eviction and reset on store changes
+#include "PatchRows.h"
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+#define ROWS 100000
+
+static int g_Failures = 0;
+
+#define CHECK(cond, ...)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                              \
+      printf(__VA_ARGS__);                                                     \
+      printf("\n");                                                            \
+      g_Failures++;                                                            \
+    }                                                                          \
+  } while (0)
+
+// Baseline BytesToHex
+static std::string BaselineBytes(const unsigned char *bytes, size_t size) {
+  std::stringstream ss;
+  ss << std::hex << std::setfill('0');
+  for (size_t i = 0; i < size; ++i) {
+    if (i > 0)
+      ss << " ";
+    ss << std::setw(2) << (int)bytes[i];
+  }
+  return ss.str();
+}
+
+// Baseline address column
+static std::string BaselineAddress(duint address) {
+  std::stringstream ss;
+  ss << std::hex << std::uppercase << address;
+  return ss.str();
+}
+
+static void FillStore(PatchStore &store, size_t rows) {
+  std::mt19937 rng(3);
+  duint address = 0x400000;
+  for (size_t i = 0; i < rows; ++i) {
+    PatchInfo p = {};
+    p.address = address;
+    p.head = address;
+    size_t size = 1 + rng() % 8;
+    for (size_t k = 0; k < size; ++k) {
+      p.oldBytes.push_back((unsigned char)rng());
+      p.newBytes.push_back((unsigned char)rng());
+    }
+    p.oldDisasm = "mov eax, ecx";
+    p.disasm = "nop";
+    p.comment = i % 3 ? "" : "comment";
+    store.Append(p);
+    address += size + rng() % 0x1000;
+  }
+}
+
+static void TestFormatting(const PatchStore &store) {
+  std::string text;
+  for (size_t i = 0; i < store.size(); ++i) {
+    FormatAddress(store.Address(i), text);
+    CHECK(text == BaselineAddress(store.Address(i)), "address %zu: '%s'", i,
+          text.c_str());
+    FormatBytes(store.OldBytes(i), store.ByteCount(i), text);
+    CHECK(text == BaselineBytes(store.OldBytes(i), store.ByteCount(i)),
+          "old bytes %zu: '%s'", i, text.c_str());
+    FormatBytes(store.NewBytes(i), store.ByteCount(i), text);
+    CHECK(text == BaselineBytes(store.NewBytes(i), store.ByteCount(i)),
+          "new bytes %zu: '%s'", i, text.c_str());
+  }
+
+  // Edges of the address range and an empty byte list
+  const duint addresses[] = {0, 0xF, 0x10, 0xABCDEF, (duint)-1};
+  for (duint address : addresses) {
+    FormatAddress(address, text);
+    CHECK(text == BaselineAddress(address), "address %llx: '%s'",
+          (unsigned long long)address, text.c_str());
+  }
+  FormatBytes(NULL, 0, text);
+  CHECK(text.empty(), "no bytes: '%s'", text.c_str());
+}
+
+static void TestCells(const PatchStore &store) {
+  PatchRowCache cache(64);
+  for (size_t i = 0; i < store.size(); i += 7) {
+    CHECK(cache.Text(store, i, COLUMN_ADDRESS) ==
+              BaselineAddress(store.Address(i)),
+          "cell address %zu", i);
+    CHECK(cache.Text(store, i, COLUMN_OLD_BYTES) ==
+              BaselineBytes(store.OldBytes(i), store.ByteCount(i)),
+          "cell old bytes %zu", i);
+    CHECK(cache.Text(store, i, COLUMN_NEW_BYTES) ==
+              BaselineBytes(store.NewBytes(i), store.ByteCount(i)),
+          "cell new bytes %zu", i);
+    CHECK(!strcmp(cache.Text(store, i, COLUMN_OLD), store.OldDisasm(i)),
+          "cell old disasm %zu", i);
+    CHECK(!strcmp(cache.Text(store, i, COLUMN_NEW), store.Disasm(i)),
+          "cell new disasm %zu", i);
+    CHECK(!strcmp(cache.Text(store, i, COLUMN_COMMENT), store.Comment(i)),
+          "cell comment %zu", i);
+    CHECK(cache.size() <= 64, "%zu rows kept", cache.size());
+  }
+}
+
+static void TestEviction(PatchStore &store) {
+  PatchRowCache cache(4);
+  for (size_t i = 0; i < 4; ++i)
+    cache.Text(store, i, COLUMN_ADDRESS);
+  CHECK(cache.size() == 4, "%zu rows kept, want 4", cache.size());
+
+  // Row 0 is used again, so row 1 is the least recently used
+  cache.Text(store, 0, COLUMN_OLD_BYTES);
+  cache.Text(store, 9, COLUMN_ADDRESS);
+  CHECK(cache.size() == 4, "%zu rows kept after eviction, want 4",
+        cache.size());
+
+  // Text stays right whatever was evicted on the way
+  std::string want;
+  for (size_t i = 0; i < 12; ++i) {
+    FormatBytes(store.NewBytes(i), store.ByteCount(i), want);
+    CHECK(want == cache.Text(store, i, COLUMN_NEW_BYTES), "row %zu", i);
+  }
+
+  // A changed store drops every formatted row
+  PatchInfo p = {};
+  p.address = store.Address(store.size() - 1) + 0x10000;
+  store.Append(p);
+  cache.Text(store, 0, COLUMN_ADDRESS);
+  CHECK(cache.size() == 1, "%zu rows kept after store change, want 1",
+        cache.size());
+  cache.clear();
+  CHECK(cache.size() == 0, "%zu rows kept after clear", cache.size());
+}
+
+int main() {
+  PatchStore store;
+  FillStore(store, ROWS);
+  TestFormatting(store);
+  TestCells(store);
+  TestEviction(store);
+  if (g_Failures)
+    printf("%d failures\n", g_Failures);
+  return g_Failures ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+// Incremental sync against a from-scratch rebuild, over a simulated
+// debugger (SimDebugger). Every round makes random patch edits, syncs the
+// running list with the reuse path and compares it with a full rebuild into
+// an empty list. A final round reloads the module at another base and
+// checks that groups served from the cache match a rebuild there without
+// decoding anything, and a list of many publishing blocks is checked against
+// the debugger.
+#include "PatchSync.h"
+#include "SimDebugger.h"
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define MODULE_BASE 0x140000000ull
+#define REBASED_MODULE_BASE 0x7FF612340000ull
+#define HEAP_BASE 0x2A0000ull
+#define ROUNDS 40
+#define HOT_AREA_SIZE 0x100
+// A function start the last round jumps to, so a comment names it
+#define JUMP_TARGET_RVA (4 * SIM_FUNCTION_SIZE)
+
+static int g_Failures = 0;
+
+#define CHECK(cond, ...)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                              \
+      printf(__VA_ARGS__);                                                     \
+      printf("\n");                                                            \
+      g_Failures++;                                                            \
+    }                                                                          \
+  } while (0)
+
+static SyncState Sync(PatchStore &all, bool fullRebuild) {
+  StartPatchSync(NULL, fullRebuild, all);
+  SyncProgress progress;
+  do {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    progress = CollectPatchSync(all);
+  } while (progress.state == SYNC_RUNNING);
+  return progress.state;
+}
+
+// "Sync: N groups, R reused, C from cache, ..."
+static void SyncCounts(int &groups, int &reused, int &cached) {
+  groups = reused = cached = -1;
+  sscanf(SimLastLog().c_str(), "[PatchMgr] Sync: %d groups, %d reused, %d",
+         &groups, &reused, &cached);
+}
+
+static void CompareStores(const PatchStore &got, const PatchStore &want,
+                          const char *what) {
+  CHECK(got.size() == want.size(), "%s: %zu groups, want %zu", what,
+        got.size(), want.size());
+  for (size_t i = 0; i < got.size() && i < want.size(); ++i) {
+    PatchInfo a = got.Get(i), b = want.Get(i);
+    bool same = a.address == b.address && a.head == b.head &&
+                a.oldBytes == b.oldBytes && a.newBytes == b.newBytes &&
+                a.module == b.module && a.oldDisasm == b.oldDisasm &&
+                a.disasm == b.disasm && a.comment == b.comment &&
+                a.active == b.active;
+    CHECK(same,
+          "%s: group %zu at %llx differs: head %llx/%llx, old '%s'/'%s', "
+          "new '%s'/'%s', comment '%s'/'%s'",
+          what, i, (unsigned long long)a.address, (unsigned long long)a.head,
+          (unsigned long long)b.head, a.oldDisasm.c_str(),
+          b.oldDisasm.c_str(), a.disasm.c_str(), b.disasm.c_str(),
+          a.comment.c_str(), b.comment.c_str());
+    if (!same)
+      return; // The rest is usually the same mismatch shifted
+  }
+}
+
+// A few runs of patched bytes, a few restores, a few single-byte changes.
+// Half of them go to a small hot area, so edits land next to unchanged
+// groups and their instructions.
+static void EditPatches(std::mt19937 &rng) {
+  for (int edit = 0; edit < 12; ++edit) {
+    bool heap = rng() % 4 == 0;
+    duint base = heap ? SimHeapBase() : SimModuleBase();
+    size_t size = heap ? SIM_HEAP_SIZE : SIM_MODULE_SIZE;
+    if (rng() % 2)
+      size = HOT_AREA_SIZE;
+    duint addr = base + rng() % (size - 16);
+    size_t length = 1 + rng() % 6;
+    switch (rng() % 3) {
+    case 0:
+      for (size_t k = 0; k < length; ++k)
+        SimPatch(addr + k, (unsigned char)rng());
+      break;
+    case 1:
+      for (size_t k = 0; k < length * 4; ++k)
+        SimRestore(addr + k);
+      break;
+    default:
+      SimPatch(addr, (unsigned char)rng());
+      break;
+    }
+  }
+}
+
+// Groups packed across the whole module, many publishing blocks' worth, so
+// head lookups reach back into blocks already published. Heads must match
+// what the debugger says, from scratch and incrementally.
+static void TestLargeSync() {
+  SimReset(9, MODULE_BASE, HEAP_BASE);
+  std::mt19937 rng(2);
+  duint end = SimModuleBase() + SIM_MODULE_SIZE - 16;
+  for (duint addr = SimModuleBase() + 16; addr < end; addr += 2 + rng() % 6)
+    SimPatch(addr, (unsigned char)rng());
+
+  PatchStore all;
+  CHECK(Sync(all, true) == SYNC_DONE, "large: full sync failed");
+  char expr[64];
+  size_t wrong = 0;
+  for (size_t i = 0; i < all.size(); ++i) {
+    snprintf(expr, sizeof(expr), "dis.prev(0x%llX + 1)",
+             (unsigned long long)all.Address(i));
+    wrong += all.Head(i) != DbgEval(expr, NULL);
+  }
+  CHECK(wrong == 0, "large: %zu of %zu heads wrong", wrong, all.size());
+
+  EditPatches(rng);
+  PatchStore scratch;
+  CHECK(Sync(all, false) == SYNC_DONE, "large: incremental sync failed");
+  CHECK(Sync(scratch, true) == SYNC_DONE, "large: second full sync failed");
+  CompareStores(all, scratch, "large");
+  printf("large: %zu groups\n", all.size());
+}
+
+int main() {
+  std::mt19937 rng(1);
+  SimReset(7, MODULE_BASE, HEAP_BASE);
+  for (duint k = 0; k < SIM_MODULE_SIZE; k += 0x333)
+    SimSetComment(SimModuleBase() + k, "user comment");
+
+  PatchStore all;
+  long reusedTotal = 0, cachedTotal = 0;
+  for (int round = 0; round < ROUNDS; ++round) {
+    EditPatches(rng);
+    CHECK(Sync(all, false) == SYNC_DONE, "round %d: incremental sync failed",
+          round);
+    int groups, reused, cached;
+    SyncCounts(groups, reused, cached);
+    reusedTotal += reused;
+    cachedTotal += cached;
+
+    PatchStore scratch;
+    CHECK(Sync(scratch, true) == SYNC_DONE, "round %d: full sync failed",
+          round);
+    char what[32];
+    snprintf(what, sizeof(what), "round %d", round);
+    CompareStores(all, scratch, what);
+  }
+  // Otherwise the comparison proved nothing about the reuse path
+  CHECK(reusedTotal > 0, "no group was reused");
+
+  // A jump to a labelled function start: the comment holds its address
+  duint target = SimModuleBase() + JUMP_TARGET_RVA;
+  char expr[64];
+  snprintf(expr, sizeof(expr), "dis.prev(0x%llX + 1)",
+           (unsigned long long)(target - 0x20));
+  duint jump = DbgEval(expr, NULL);
+  SimPatch(jump, 0x01); // Two bytes long, a jump
+  SimPatch(jump + 1, (unsigned char)(target - jump - 2));
+  PatchStore jumpScratch;
+  CHECK(Sync(all, false) == SYNC_DONE, "jump round: incremental sync failed");
+  CHECK(Sync(jumpScratch, true) == SYNC_DONE, "jump round: full sync failed");
+  CompareStores(all, jumpScratch, "jump round");
+  printf("%d rounds, %zu patched bytes, %zu groups, %ld reused, %ld cached\n",
+         ROUNDS, SimPatchCount(), all.size(), reusedTotal, cachedTotal);
+
+  // Restart with the module at another base and the same patches: heads
+  // come from the cache, text must follow the new base
+  std::vector<std::pair<duint, unsigned char>> patches;
+  for (size_t i = 0; i < all.size(); ++i) {
+    if (all.Module(i) == MODULE_NONE)
+      continue;
+    for (size_t k = 0; k < all.ByteCount(i); ++k)
+      patches.push_back(
+          {all.Address(i) + k - MODULE_BASE, all.NewBytes(i)[k]});
+  }
+  SimReset(7, REBASED_MODULE_BASE, HEAP_BASE);
+  for (const auto &p : patches)
+    SimPatch(REBASED_MODULE_BASE + p.first, p.second);
+
+  PatchStore warm, scratch;
+  size_t decoded = SimDisasmCalls();
+  CHECK(Sync(warm, false) == SYNC_DONE, "rebased sync failed");
+  decoded = SimDisasmCalls() - decoded;
+  int groups, reused, cached;
+  SyncCounts(groups, reused, cached);
+  CHECK(cached > 0 && cached == groups, "rebased: %d of %d groups cached",
+        cached, groups);
+  CHECK(decoded == 0, "rebased: %zu instructions decoded", decoded);
+
+  // Comments print 32 bits of the address
+  char comment[64];
+  snprintf(comment, sizeof(comment), "0x%X: \"fn%u\"",
+           (unsigned int)(REBASED_MODULE_BASE + JUMP_TARGET_RVA),
+           (unsigned int)(JUMP_TARGET_RVA / SIM_FUNCTION_SIZE));
+  bool named = false;
+  for (size_t i = 0; i < warm.size(); ++i)
+    named = named || !strcmp(warm.Comment(i), comment);
+  CHECK(named, "rebased: no group commented '%s'", comment);
+  CHECK(Sync(scratch, true) == SYNC_DONE, "rebased full sync failed");
+  CompareStores(warm, scratch, "rebased");
+  printf("rebased: %d groups, %d from cache, %zu cache entries\n", groups,
+         cached, SimCacheSize());
+
+  TestLargeSync();
+  if (g_Failures)
+    printf("%d failures\n", g_Failures);
+  return g_Failures ? 1 : 0;
+}
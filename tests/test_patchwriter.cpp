@@ -0,0 +1,186 @@
+// CoalescePatchWrites: overlapping writes resolved in submission order
+// whatever their start addresses, gaps of up to PATCH_COALESCE_GAP bytes
+// bridged and the canBridge veto, plus the bytes ApplyPatchWrites lays down
+// on the simulated debugger for overlapping writes
+#include "PatchWriter.h"
+#include "SimDebugger.h"
+#include <stdio.h>
+#include <vector>
+
+#define MODULE_BASE 0x140000000ull
+#define HEAP_BASE 0x2A0000ull
+
+static int g_Failures = 0;
+
+#define CHECK(cond, ...)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                              \
+      printf(__VA_ARGS__);                                                     \
+      printf("\n");                                                            \
+      g_Failures++;                                                            \
+    }                                                                          \
+  } while (0)
+
+static const unsigned char g_Ones[8] = {1, 1, 1, 1, 1, 1, 1, 1};
+static const unsigned char g_Twos[8] = {2, 2, 2, 2, 2, 2, 2, 2};
+
+// Lay a range's writes down in the order CoalescePatchWrites left them
+static std::vector<unsigned char>
+Merge(const std::vector<PatchWrite> &writes, const std::vector<size_t> &order,
+      const PatchRange &r) {
+  std::vector<unsigned char> block(r.size, 0);
+  for (size_t k = r.first; k < r.first + r.count; ++k) {
+    const PatchWrite &w = writes[order[k]];
+    for (size_t b = 0; b < w.size; ++b)
+      block[(size_t)(w.address - r.address) + b] = w.bytes[b];
+  }
+  return block;
+}
+
+static void TestOverlap() {
+  std::vector<size_t> order;
+  std::vector<PatchRange> ranges;
+
+  // The later write starts first: sorting by address alone would let the
+  // earlier one win at 0x10-0x11
+  std::vector<PatchWrite> writes = {{0x10, g_Ones, 4}, {0x0E, g_Twos, 4}};
+  CoalescePatchWrites(writes, PATCH_COALESCE_GAP, NULL, order, ranges);
+  CHECK(ranges.size() == 1, "%zu ranges, want 1", ranges.size());
+  if (ranges.size() == 1) {
+    const PatchRange &r = ranges[0];
+    CHECK(r.address == 0x0E && r.size == 6 && !r.gaps,
+          "range %llx+%zu gaps %d", (unsigned long long)r.address, r.size,
+          r.gaps);
+    std::vector<unsigned char> want = {2, 2, 2, 2, 1, 1};
+    CHECK(Merge(writes, order, r) == want, "later start lost the overlap");
+  }
+
+  // The later write starts last
+  writes = {{0x0E, g_Ones, 4}, {0x10, g_Twos, 4}};
+  CoalescePatchWrites(writes, PATCH_COALESCE_GAP, NULL, order, ranges);
+  CHECK(ranges.size() == 1, "%zu ranges, want 1", ranges.size());
+  if (ranges.size() == 1) {
+    std::vector<unsigned char> want = {1, 1, 2, 2, 2, 2};
+    CHECK(Merge(writes, order, ranges[0]) == want,
+          "later end lost the overlap");
+  }
+
+  // One write inside another, submitted before and after it
+  writes = {{0x20, g_Twos, 2}, {0x1F, g_Ones, 4}, {0x21, g_Twos, 1}};
+  CoalescePatchWrites(writes, PATCH_COALESCE_GAP, NULL, order, ranges);
+  CHECK(ranges.size() == 1, "%zu ranges, want 1", ranges.size());
+  if (ranges.size() == 1) {
+    std::vector<unsigned char> want = {1, 1, 2, 1};
+    CHECK(Merge(writes, order, ranges[0]) == want, "nested writes");
+  }
+}
+
+static void TestGaps() {
+  std::vector<size_t> order;
+  std::vector<PatchRange> ranges;
+
+  // 16 untouched bytes are bridged, 17 are not
+  std::vector<PatchWrite> writes = {
+      {0x100, g_Ones, 2},
+      {0x102 + PATCH_COALESCE_GAP, g_Ones, 2},
+      {0x104 + 2 * PATCH_COALESCE_GAP + 1, g_Ones, 2}};
+  CoalescePatchWrites(writes, PATCH_COALESCE_GAP, NULL, order, ranges);
+  CHECK(ranges.size() == 2, "%zu ranges, want 2", ranges.size());
+  if (ranges.size() == 2) {
+    CHECK(ranges[0].address == 0x100 &&
+              ranges[0].size == 4 + PATCH_COALESCE_GAP && ranges[0].gaps &&
+              ranges[0].count == 2,
+          "bridged range %llx+%zu gaps %d count %zu",
+          (unsigned long long)ranges[0].address, ranges[0].size,
+          ranges[0].gaps, ranges[0].count);
+    CHECK(ranges[1].address == writes[2].address && ranges[1].size == 2 &&
+              !ranges[1].gaps && ranges[1].count == 1,
+          "separate range %llx+%zu", (unsigned long long)ranges[1].address,
+          ranges[1].size);
+  }
+
+  // Writes that only touch join without a gap
+  writes = {{0x200, g_Ones, 2}, {0x202, g_Twos, 2}};
+  CoalescePatchWrites(writes, PATCH_COALESCE_GAP, NULL, order, ranges);
+  CHECK(ranges.size() == 1 && !ranges[0].gaps && ranges[0].size == 4,
+        "touching writes");
+
+  // No bridging at all with a zero gap
+  writes = {{0x300, g_Ones, 2}, {0x303, g_Ones, 2}};
+  CoalescePatchWrites(writes, 0, NULL, order, ranges);
+  CHECK(ranges.size() == 2, "%zu ranges with maxGap 0, want 2",
+        ranges.size());
+}
+
+static std::vector<std::pair<duint, duint>> g_Asked;
+
+// Refuses the gap that starts at 0x402
+static bool VetoAt402(duint begin, duint end) {
+  g_Asked.push_back({begin, end});
+  return begin != 0x402;
+}
+
+static void TestVeto() {
+  std::vector<size_t> order;
+  std::vector<PatchRange> ranges;
+  std::vector<PatchWrite> writes = {
+      {0x400, g_Ones, 2}, {0x408, g_Ones, 2}, {0x410, g_Ones, 2}};
+  g_Asked.clear();
+  CoalescePatchWrites(writes, PATCH_COALESCE_GAP, VetoAt402, order, ranges);
+  CHECK(ranges.size() == 2, "%zu ranges, want 2", ranges.size());
+  if (ranges.size() == 2) {
+    CHECK(ranges[0].address == 0x400 && ranges[0].size == 2,
+          "vetoed range %llx+%zu", (unsigned long long)ranges[0].address,
+          ranges[0].size);
+    CHECK(ranges[1].address == 0x408 && ranges[1].size == 10 &&
+              ranges[1].gaps,
+          "allowed range %llx+%zu", (unsigned long long)ranges[1].address,
+          ranges[1].size);
+  }
+  // Asked with the gap's [begin, end), and never for touching writes
+  std::vector<std::pair<duint, duint>> want = {{0x402, 0x408},
+                                               {0x40A, 0x410}};
+  CHECK(g_Asked == want, "canBridge asked %zu times", g_Asked.size());
+
+  g_Asked.clear();
+  writes = {{0x500, g_Ones, 2}, {0x502, g_Ones, 2}};
+  CoalescePatchWrites(writes, PATCH_COALESCE_GAP, VetoAt402, order, ranges);
+  CHECK(g_Asked.empty() && ranges.size() == 1, "touching writes asked");
+}
+
+// End to end: what lands in memory for overlapping writes with different
+// starts, across a bridged gap that must keep its bytes
+static void TestApply() {
+  SimReset(3, MODULE_BASE, HEAP_BASE);
+  duint base = SimModuleBase() + 0x1000;
+  unsigned char gap[6];
+  DbgMemRead(base + 6, gap, sizeof(gap));
+
+  std::vector<PatchWrite> writes = {
+      {base + 2, g_Ones, 4}, {base, g_Twos, 4}, {base + 12, g_Ones, 2}};
+  std::vector<bool> ok;
+  PatchWriteStats stats = ApplyPatchWrites(writes, ok);
+  CHECK(stats.ranges == 1 && stats.rangesFailed == 0, "%d ranges, %d failed",
+        stats.ranges, stats.rangesFailed);
+  CHECK(ok.size() == 3 && ok[0] && ok[1] && ok[2], "a write failed");
+
+  unsigned char got[14];
+  DbgMemRead(base, got, sizeof(got));
+  const unsigned char want[6] = {2, 2, 2, 2, 1, 1};
+  for (size_t k = 0; k < 6; ++k)
+    CHECK(got[k] == want[k], "byte %zu is %u, want %u", k, got[k], want[k]);
+  for (size_t k = 0; k < sizeof(gap); ++k)
+    CHECK(got[6 + k] == gap[k], "gap byte %zu changed", k);
+  CHECK(got[12] == 1 && got[13] == 1, "last write missing");
+}
+
+int main() {
+  TestOverlap();
+  TestGaps();
+  TestVeto();
+  TestApply();
+  if (g_Failures)
+    printf("%d failures\n", g_Failures);
+  return g_Failures ? 1 : 0;
+}